@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <istream>   // istreambuf_iterator
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpp8080/meta/instructions.hh"
+#include "cpp8080/specific/cpu.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Only used to get the description of instructions.
+struct aot_machine
+{
+  using overrides = cpp8080::meta::instructions<>;
+};
+
+using cpu_type = cpp8080::specific::cpu<aot_machine>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct instruction
+{
+  std::uint16_t address;
+  std::uint8_t opcode;
+  std::uint16_t operands;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+class recompiler
+{
+public:
+
+  recompiler(std::vector<std::uint8_t> rom, std::uint16_t origin)
+    : rom_{std::move(rom)}
+    , origin_{origin}
+    , blocks_{}
+  {}
+
+  // Follow the control flow from the entry points, decode a block at each reached address.
+  void
+  explore(std::vector<std::uint16_t> entries)
+  {
+    while (not entries.empty())
+    {
+      const auto address = entries.back();
+      entries.pop_back();
+      if (not in_rom(address, 1) or blocks_.count(address))
+      {
+        continue;
+      }
+
+      // PC doesn't wrap around: a block reaching the end of the ROM or of the address space stops.
+      auto& block = blocks_[address];
+      for (auto pc = std::uint32_t{address}; in_rom(pc, 1);)
+      {
+        const auto opcode = rom_[pc - origin_];
+        const auto bytes = cpu_type::instruction_bytes(opcode);
+        if (not in_rom(pc, bytes))
+        {
+          break;
+        }
+        auto operands = std::uint16_t{0};
+        if (bytes >= 2)
+        {
+          operands = rom_[pc + 1 - origin_];
+        }
+        if (bytes == 3)
+        {
+          operands |= rom_[pc + 2 - origin_] << 8;
+        }
+        block.push_back({static_cast<std::uint16_t>(pc), opcode, operands});
+        pc += bytes;
+
+        if (cpu_type::ends_block(opcode))
+        {
+          successors(opcode, operands, static_cast<std::uint16_t>(pc), entries);
+          break;
+        }
+      }
+
+      if (block.empty())
+      {
+        blocks_.erase(address);
+      }
+    }
+  }
+
+  void
+  generate(std::ostream& os, const std::string& header, const std::string& machine,
+           const std::string& function)
+  const
+  {
+    os << "// Generated by cpp8080_aot, do not edit.\n"
+       << "\n"
+       << "#include <cstdint>\n"
+       << "#include <vector>\n"
+       << "\n"
+       << "#include \"" << header << "\"\n"
+       << "\n"
+       << "namespace {\n"
+       << "\n"
+       << "using cpu_type = cpp8080::specific::cpu<" << machine << ">;\n"
+       << "using decoded_type = cpp8080::meta::decoded_instruction<cpu_type>;\n"
+       << "\n"
+       << "const std::uint8_t rom[] = {";
+    for (auto i = std::size_t{0}; i < rom_.size(); ++i)
+    {
+      os << (i % 16 == 0 ? "\n  " : " ") << hex(rom_[i], 2) << ',';
+    }
+    os << "\n};\n";
+
+    for (const auto& [address, block] : blocks_)
+    {
+      os << "\n"
+         << "std::uint64_t\n"
+         << "block_" << hex(address, 4)
+         << "(cpu_type& cpu, const decoded_type* instruction, std::uint64_t cycles,"
+         << " const std::uint64_t& limit)\n"
+         << "{\n";
+      for (const auto& i : block)
+      {
+        os << "  // " << hex(i.address, 4) << ' ' << cpu_type::instruction_name(i.opcode) << '\n'
+           << "  if ((cycles += cpu.execute<" << hex(i.opcode, 2) << ">(" << hex(i.operands, 4)
+           << ")) >= limit) { return cycles; }\n";
+      }
+      os << "  ++instruction;\n"
+         << "  return instruction->handler(cpu, instruction, cycles, limit);\n"
+         << "}\n";
+    }
+
+    os << "\n"
+       << "} // namespace\n"
+       << "\n"
+       << "const std::vector<cpp8080::meta::compiled_block<cpu_type>>&\n"
+       << function << "()\n"
+       << "{\n"
+       << "  static const auto blocks = std::vector<cpp8080::meta::compiled_block<cpu_type>>{\n";
+    for (const auto& [address, block] : blocks_)
+    {
+      const auto& last = block.back();
+      const auto end = last.address + cpu_type::instruction_bytes(last.opcode) - 1;
+      os << "    {" << hex(address, 4) << ", " << hex(end, 4) << ", rom + "
+         << hex(address - origin_, 4) << ", &block_" << hex(address, 4) << "},\n";
+    }
+    os << "  };\n"
+       << "  return blocks;\n"
+       << "}\n";
+  }
+
+  [[nodiscard]]
+  std::size_t
+  size()
+  const noexcept
+  {
+    return blocks_.size();
+  }
+
+private:
+
+  // Addresses at which execution may continue after an instruction ending a block.
+  // The destinations of ret and pchl are unknown, these blocks are left to the interpreter.
+  static
+  void
+  successors(std::uint8_t opcode, std::uint16_t operands, std::uint16_t next,
+             std::vector<std::uint16_t>& entries)
+  {
+    if (opcode == 0xc3 or opcode == 0xcd)     // jmp, call
+    {
+      entries.push_back(operands);
+    }
+    if ((opcode & 0xc7) == 0xc2 or (opcode & 0xc7) == 0xc4) // conditional jump and call
+    {
+      entries.push_back(operands);
+    }
+    if ((opcode & 0xc7) == 0xc7)              // rst
+    {
+      entries.push_back(opcode & 0x38);
+    }
+    if (opcode != 0xc3 and opcode != 0xc9 and opcode != 0xe9)
+    {
+      entries.push_back(next);                // returns, not taken conditions, after hlt
+    }
+  }
+
+  [[nodiscard]]
+  bool
+  in_rom(std::uint32_t address, std::uint32_t bytes)
+  const noexcept
+  {
+    return address >= origin_ and address + bytes <= 0x10000
+       and std::size_t{address - origin_} + bytes <= rom_.size();
+  }
+
+  [[nodiscard]]
+  static
+  std::string
+  hex(unsigned int value, int width)
+  {
+    auto ss = std::ostringstream{};
+    ss << "0x" << std::hex << std::setfill('0') << std::setw(width) << value;
+    return ss.str();
+  }
+
+private:
+
+  std::vector<std::uint8_t> rom_;
+  std::uint16_t origin_;
+  std::map<std::uint16_t, std::vector<instruction>> blocks_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Translate the code of a ROM to C++ functions executed by the cpu in place of decoded blocks.
+int
+main(int argc, const char** argv)
+{
+  if (argc != 7)
+  {
+    std::cerr << "Usage: " << argv[0] << " rom origin header machine function output\n";
+    return 1;
+  }
+
+  auto file = std::ifstream{argv[1], std::ios::binary};
+  if (not file.is_open())
+  {
+    std::cerr << "Cannot open ROM file " << argv[1] << '\n';
+    return 1;
+  }
+  auto rom = std::vector<std::uint8_t>{std::istreambuf_iterator<char>{file},
+                                       std::istreambuf_iterator<char>{}};
+
+  const auto origin = static_cast<std::uint16_t>(std::stoul(argv[2], nullptr, 0));
+  if (rom.size() > 0x10000u - origin)
+  {
+    std::cerr << "ROM does not fit in memory\n";
+    return 1;
+  }
+
+  // Start at the origin and at the restart vectors, which are the entry points of interrupts.
+  auto entries = std::vector<std::uint16_t>{origin};
+  for (auto vector = 0; vector < 0x40; vector += 8)
+  {
+    entries.push_back(vector);
+  }
+
+  auto r = recompiler{std::move(rom), origin};
+  r.explore(std::move(entries));
+
+  auto output = std::ofstream{argv[6]};
+  r.generate(output, argv[3], argv[4], argv[5]);
+  if (not output)
+  {
+    std::cerr << "Cannot write " << argv[6] << '\n';
+    return 1;
+  }
+  std::cout << "Compiled " << r.size() << " blocks\n";
+}
+
+/*------------------------------------------------------------------------------------------------*/
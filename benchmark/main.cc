@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <istream>    // istreambuf_iterator
+#include <string>
+#include <vector>
+
+#include "cpp8080/meta/instructions.hh"
+#include "cpp8080/specific/cpu.hh"
+#include "cpp8080/specific/memory.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A CP/M program, e.g. one of the CPU test ROMs, whose output is discarded, executed with one of
+// the policies of the ALU.
+template <bool AluTables, bool LazyFlags>
+class cpm
+{
+private:
+
+  struct call : cpp8080::meta::describe_instruction<0xcd, 11, 3>
+  {
+    static constexpr auto name = "call";
+
+    void operator()(cpp8080::specific::cpu<cpm>& cpu) const noexcept
+    {
+      // Calls to the BDOS return at once.
+      if (const auto operands = cpu.operands_word(); operands != 5)
+      {
+        cpu.call(operands);
+      }
+    }
+  };
+
+public:
+
+  using overrides = cpp8080::meta::make_instructions<call>;
+
+  static constexpr bool alu_tables = AluTables;
+  static constexpr bool lazy_flags = LazyFlags;
+
+public:
+
+  explicit
+  cpm(const std::vector<std::uint8_t>& program)
+    : cpu_{*this}
+    , memory_(65536, 0)
+  {
+    std::copy(begin(program), end(program), memory_.begin() + 0x100);
+    // CP/M programs give back control to the system by jumping to 0x0000, where a hlt is placed.
+    memory_[0x0000] = 0x76;
+    cpu_.jump(0x100);
+  }
+
+  void
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  noexcept
+  {
+    memory_[address] = value;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  memory_read_byte(std::uint16_t address)
+  const noexcept
+  {
+    return memory_[address];
+  }
+
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {memory_.data(), 0, 65536};
+  }
+
+  // Execute the program for at most budget cycles. Return the number of executed cycles.
+  std::uint64_t
+  operator()(std::uint64_t budget)
+  {
+    return cpu_.run(budget).cycles;
+  }
+
+private:
+
+  cpp8080::specific::cpu<cpm> cpu_;
+  std::vector<std::uint8_t> memory_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The best time of several runs of program with a policy, in seconds, along with the number of
+// cycles it executed.
+template <bool AluTables, bool LazyFlags>
+std::pair<double, std::uint64_t>
+measure(const std::vector<std::uint8_t>& program, std::uint64_t budget, int runs)
+{
+  auto best = 0.0;
+  auto cycles = std::uint64_t{0};
+  for (auto i = 0; i < runs; ++i)
+  {
+    auto machine = cpm<AluTables, LazyFlags>{program};
+    const auto start = std::chrono::steady_clock::now();
+    cycles = machine(budget);
+    const auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    best = i == 0 ? time.count() : std::min(best, time.count());
+  }
+  return {best, cycles};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, const char** argv)
+{
+  if (argc < 2 or argc > 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " /path/to/program.com [cycles] [runs]\n";
+    return 1;
+  }
+
+  auto file = std::ifstream{argv[1], std::ios::binary};
+  if (not file.is_open())
+  {
+    std::cerr << "Cannot open program " << argv[1] << '\n';
+    return 1;
+  }
+  const auto program = std::vector<std::uint8_t>{
+    std::istreambuf_iterator<char>{file},
+    std::istreambuf_iterator<char>{}
+  };
+  const auto budget = argc > 2 ? std::stoull(argv[2]) : std::uint64_t{2'000'000'000};
+  const auto runs = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  const auto report = [](const char* policy, std::pair<double, std::uint64_t> result)
+  {
+    const auto [time, cycles] = result;
+    std::cout << std::left << std::setw(12) << policy << std::right << std::fixed
+              << std::setprecision(3) << std::setw(8) << time << " s "
+              << std::setprecision(0) << std::setw(6) << cycles / time / 1e6 << " MHz\n";
+  };
+  report("arithmetic", measure<false, false>(program, budget, runs));
+  report("lazy flags", measure<false, true>(program, budget, runs));
+  report("ALU tables", measure<true, false>(program, budget, runs));
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm> // equal, find_if
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "cpp8080/meta/instructions.hh"
+
+namespace cpp8080::meta {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// An instruction whose opcode and operands have already been read from memory.
+template <typename Cpu>
+struct decoded_instruction final
+{
+  using handler_type =
+    std::uint64_t (*) (Cpu&, const decoded_instruction*, std::uint64_t, const std::uint64_t&);
+
+  handler_type handler;
+  std::uint16_t operands;
+  std::uint8_t opcode;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A block compiled ahead of time from code, which covers addresses first to last.
+// It's executed like a decoded handler, in place of the block decoded at first, as long as memory
+// still holds code.
+template <typename Cpu>
+struct compiled_block final
+{
+  std::uint16_t first;
+  std::uint16_t last;
+  const std::uint8_t* code;
+  typename decoded_instruction<Cpu>::handler_type execute;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Opcodes of consecutive instructions executed by a single decoded handler.
+template <std::uint8_t... Opcodes>
+struct sequence final
+{};
+
+template <typename... Sequences>
+struct sequences final
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+// Direct threaded code: each handler executes its instruction, then tail-calls the handler of the
+// next decoded instruction, until limit cycles have been consumed.
+template <typename Cpu, typename... Instructions>
+struct decoded_handlers final
+{
+  using decoded_type = decoded_instruction<Cpu>;
+
+  template <std::uint8_t Opcode>
+  using instruction_type = nth_instruction<Opcode, instructions<Instructions...>>;
+
+  template <typename Instruction>
+  static
+  std::uint64_t
+  handler(Cpu& cpu, const decoded_type* instruction, std::uint64_t cycles, const std::uint64_t& limit)
+  {
+    cpu.template load_operands<Instruction::bytes>(instruction->operands);
+    cycles += Instruction{}(cpu);
+    if (cycles >= limit)
+    {
+      return cycles;
+    }
+    ++instruction;
+    return instruction->handler(cpu, instruction, cycles, limit);
+  }
+
+  // Execute a sequence of decoded instructions in a single dispatch, each one with the operands of
+  // its own entry.
+  template <std::uint8_t... Opcodes>
+  static
+  std::uint64_t
+  fused_handler(Cpu& cpu, const decoded_type* instruction, std::uint64_t cycles,
+                const std::uint64_t& limit)
+  {
+    const auto reached = (
+      (cpu.template load_operands<instruction_type<Opcodes>::bytes>(instruction->operands),
+       cycles += instruction_type<Opcodes>{}(cpu),
+       ++instruction,
+       cycles >= limit) or ...);
+    if (reached)
+    {
+      return cycles;
+    }
+    return instruction->handler(cpu, instruction, cycles, limit);
+  }
+
+  static constexpr typename decoded_type::handler_type table[] = {&handler<Instructions>...};
+  static constexpr std::uint8_t bytes[] = {Instructions::bytes...};
+  static constexpr std::uint8_t cycles[] = {Instructions::cycles...};
+  static constexpr const char* names[] = {Instructions::name...};
+};
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Cpu, typename Instructions>
+struct decoded_handlers;
+
+template <typename Cpu, typename... Instructions>
+struct decoded_handlers<Cpu, instructions<Instructions...>> final
+{
+  static_assert(sizeof...(Instructions) == 256, "Decoding requires 256 opcodes");
+
+  using type = detail::decoded_handlers<Cpu, Instructions...>;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Maximal number of instructions in a fused sequence.
+inline constexpr auto max_fused_instructions = std::size_t{4};
+
+// A sequence of opcodes and the handler executing it.
+template <typename Cpu>
+struct fusion final
+{
+  std::size_t size;
+  std::array<std::uint8_t, max_fused_instructions> opcodes;
+  typename decoded_instruction<Cpu>::handler_type handler;
+};
+
+namespace detail {
+
+template <typename Cpu, typename Handlers, std::uint8_t... Opcodes>
+constexpr
+fusion<Cpu>
+make_fusion(sequence<Opcodes...>)
+noexcept
+{
+  static_assert(sizeof...(Opcodes) >= 2 and sizeof...(Opcodes) <= max_fused_instructions,
+                "A fused sequence has 2 to 4 instructions");
+  return {sizeof...(Opcodes), {Opcodes...}, &Handlers::template fused_handler<Opcodes...>};
+}
+
+} // namespace detail
+
+template <typename Cpu, typename Handlers, typename Sequences>
+struct fusions;
+
+// Secondary dispatch table of the pre-decoder: sequences of instructions whose handler replaces the
+// one of their first instruction. Sequences are tried in order, so longer ones should come first.
+template <typename Cpu, typename Handlers, typename... Sequences>
+struct fusions<Cpu, Handlers, sequences<Sequences...>> final
+{
+  static constexpr std::array<fusion<Cpu>, sizeof...(Sequences)> table = {
+    detail::make_fusion<Cpu, Handlers>(Sequences{})...
+  };
+
+  // Fuse the sequences found in the decoded instructions from first to last, excluded, which must
+  // belong to the same block of code.
+  static
+  void
+  fuse(decoded_instruction<Cpu>* first, decoded_instruction<Cpu>* last)
+  noexcept
+  {
+    while (first != last)
+    {
+      const auto available = static_cast<std::size_t>(last - first);
+      const auto found = std::find_if(table.begin(), table.end(), [&](const auto& f)
+      {
+        return f.size <= available
+           and std::equal(f.opcodes.begin(), f.opcodes.begin() + f.size, first,
+                          [](auto opcode, const auto& i){return i.opcode == opcode;});
+      });
+      if (found == table.end())
+      {
+        ++first;
+      }
+      else
+      {
+        first->handler = found->handler;
+        first += found->size;
+      }
+    }
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Terminates each decoded block, whose operand is the start address of the last block of code it
+// has been decoded from: continue with the block starting at the current PC.
+template <typename Cpu>
+std::uint64_t
+exit_block(Cpu& cpu, const decoded_instruction<Cpu>* instruction, std::uint64_t cycles,
+           const std::uint64_t& limit)
+{
+  const auto next = cpu.decoded_block(instruction->operands);
+  return next->handler(cpu, next, cycles, limit);
+}
+
+// Leave a trace because execution didn't take the recorded path.
+template <typename Cpu>
+std::uint64_t
+leave_trace(Cpu& cpu, const decoded_instruction<Cpu>*, std::uint64_t cycles,
+            const std::uint64_t& limit)
+{
+  const auto next = cpu.decoded_block();
+  return next->handler(cpu, next, cycles, limit);
+}
+
+// Placed between two blocks of a trace: stay in the trace if PC is the start address of the
+// next block, the operand.
+template <typename Cpu>
+std::uint64_t
+guard(Cpu& cpu, const decoded_instruction<Cpu>* instruction, std::uint64_t cycles,
+      const std::uint64_t& limit)
+{
+  if (cpu.pc() != instruction->operands)
+  {
+    return leave_trace(cpu, instruction, cycles, limit);
+  }
+  ++instruction;
+  return instruction->handler(cpu, instruction, cycles, limit);
+}
+
+// Placed after the last block of a trace which loops: go back to the first instruction of the
+// trace, opcode instructions before, if PC is the start address of the trace, the operand.
+template <typename Cpu>
+std::uint64_t
+loop_trace(Cpu& cpu, const decoded_instruction<Cpu>* instruction, std::uint64_t cycles,
+           const std::uint64_t& limit)
+{
+  if (cpu.pc() != instruction->operands)
+  {
+    return leave_trace(cpu, instruction, cycles, limit);
+  }
+  instruction -= instruction->opcode;
+  return instruction->handler(cpu, instruction, cycles, limit);
+}
+
+// Replaces loop_trace after a loop which does the same thing at each iteration until an interrupt
+// modifies memory: skip the iterations which would complete before limit is reached, then go on
+// like loop_trace.
+template <typename Cpu>
+std::uint64_t
+idle_loop(Cpu& cpu, const decoded_instruction<Cpu>* instruction, std::uint64_t cycles,
+          const std::uint64_t& limit)
+{
+  if (cpu.pc() != instruction->operands)
+  {
+    return leave_trace(cpu, instruction, cycles, limit);
+  }
+  const auto first = instruction - instruction->opcode;
+  cycles = cpu.skip_idle_iterations(first, instruction, cycles, limit);
+  return first->handler(cpu, first, cycles, limit);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Execute decoded blocks, starting with the one at the current PC, until at least limit cycles
+// have been consumed.
+template <typename Cpu>
+std::uint64_t
+run_decoded(Cpu& cpu, const std::uint64_t& limit)
+{
+  const auto first = cpu.decoded_block();
+  return first->handler(cpu, first, 0, limit);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::meta
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <stdexcept>
 #include <type_traits> // enable_if_t
 #include <utility>     // as_const
 
@@ -17,6 +16,7 @@ std::uint64_t
 execute(Cpu& cpu, Fn&& fn)
 {
   fn.pre(std::as_const(cpu), Instruction{});
+  cpu.template fetch_operands<Instruction::bytes>();
   const auto cycles = Instruction{}(cpu);
   fn.post(std::as_const(cpu), Instruction{});
   return cycles;
@@ -28,16 +28,56 @@ template <typename Cpu, typename Fn, typename... Instructions>
 std::uint64_t
 step(instructions<Instructions...>, std::uint8_t opcode, Cpu& cpu, Fn&& fn)
 {
-  if (opcode >= sizeof...(Instructions))
-  {
-    throw std::runtime_error{"Invalid opcode"};
-  }
-  
+  static_assert(sizeof...(Instructions) == 256, "Stepping requires 256 opcodes");
+
   using fun_ptr_type = std::uint64_t (*) (Cpu&, Fn&&);
   static constexpr fun_ptr_type jump_table[] = {&detail::execute<Cpu, Fn, Instructions>...};
   return jump_table[opcode](cpu, std::forward<Fn>(fn));
 }
 
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+// Threaded code: rather than returning to a shared dispatch loop, each handler fetches the next
+// opcode and tail-calls its handler, so every instruction gets its own indirect jump.
+template <typename Cpu, typename Fn, typename... Instructions>
+struct threaded final
+{
+  using handler_type = std::uint64_t (*) (Cpu&, Fn&, std::uint64_t, const std::uint64_t&);
+
+  template <typename Instruction>
+  static
+  std::uint64_t
+  handler(Cpu& cpu, Fn& fn, std::uint64_t cycles, const std::uint64_t& limit)
+  {
+    cycles += execute<Cpu, Fn&, Instruction>(cpu, fn);
+    if (cycles >= limit)
+    {
+      return cycles;
+    }
+    return table[cpu.fetch()](cpu, fn, cycles, limit);
+  }
+
+  static constexpr handler_type table[] = {&handler<Instructions>...};
+};
+
+} // namespace detail
+
+// Execute instructions until at least limit cycles have been consumed.
+// limit is read again after each instruction, so an instruction can end the chain by lowering it.
+// As handlers chain into each other, limit also bounds the call depth when the compiler doesn't
+// turn these calls into jumps (e.g. unoptimized builds).
+template <typename Cpu, typename Fn, typename... Instructions>
+std::uint64_t
+run(instructions<Instructions...>, Cpu& cpu, Fn& fn, const std::uint64_t& limit)
+{
+  static_assert(sizeof...(Instructions) == 256, "Threaded dispatch requires 256 opcodes");
+
+  using threaded = detail::threaded<Cpu, Fn, Instructions...>;
+  return threaded::table[cpu.fetch()](cpu, fn, 0, limit);
+}
+
 /*------------------------------------------------------------------------------------------------*/
   
 template <typename Instruction>
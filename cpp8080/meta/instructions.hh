@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <tuple>   // tuple_element_t
 
 namespace cpp8080::meta {
 
@@ -101,5 +104,37 @@ using override_instructions =
   typename detail::override_instructions_impl<Instructions, Overrides>::type;
   
 /*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+template <std::size_t N, typename Instructions>
+struct nth_instruction_impl;
+
+template <std::size_t N, typename... Is>
+struct nth_instruction_impl<N, instructions<Is...>>
+{
+  using type = std::tuple_element_t<N, std::tuple<Is...>>;
+};
+
+} // namespace detail
+
+template <std::size_t N, typename Instructions>
+using nth_instruction = typename detail::nth_instruction_impl<N, Instructions>::type;
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Flag the opcodes of a list of instructions.
+template <typename... Is>
+constexpr
+std::array<bool, 256>
+opcodes(instructions<Is...>)
+noexcept
+{
+  auto result = std::array<bool, 256>{};
+  ((result[Is::opcode] = true), ...);
+  return result;
+}
+
+/*------------------------------------------------------------------------------------------------*/
   
 } // namespace cpp8080::meta
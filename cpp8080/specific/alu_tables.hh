@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A machine replaces the computation of arithmetic results and flags by lookups in precomputed
+// tables by declaring `static constexpr bool alu_tables = true;`.
+template <typename Machine, typename = void>
+struct alu_tables_enabled
+  : std::false_type
+{};
+
+template <typename Machine>
+struct alu_tables_enabled<Machine, std::void_t<decltype(Machine::alu_tables)>>
+  : std::bool_constant<Machine::alu_tables>
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The values of function for each index up to Size, excluded.
+template <std::size_t Size, typename Function>
+[[nodiscard]]
+constexpr
+std::array<std::uint16_t, Size>
+tabulate(Function function)
+noexcept
+{
+  auto table = std::array<std::uint16_t, Size>{};
+  for (auto i = std::size_t{0}; i < Size; ++i)
+  {
+    table[i] = function(i);
+  }
+  return table;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm> // any_of, fill, find, remove
+#include <array>
+#include <cstdint>
+#include <memory>    // unique_ptr
+#include <vector>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Decoded blocks, looked up by their start address.
+// Each byte of memory records how many blocks have been decoded from it, so that a write to such a
+// byte can invalidate these blocks.
+// A block may have been decoded from several ranges of memory (e.g. a trace).
+template <typename Decoded>
+class block_cache final
+{
+public:
+
+  struct range final
+  {
+    std::uint16_t first;
+    std::uint16_t last; // inclusive, may wrap around
+
+    [[nodiscard]]
+    bool
+    covers(std::uint16_t address)
+    const noexcept
+    {
+      return static_cast<std::uint16_t>(address - first) <= static_cast<std::uint16_t>(last - first);
+    }
+
+    [[nodiscard]]
+    bool
+    overlaps(const range& other)
+    const noexcept
+    {
+      return covers(other.first) or other.covers(first);
+    }
+  };
+
+private:
+
+  struct block final
+  {
+    std::uint16_t start;
+    range code;                // the first range, looked at first as most blocks have only one
+    std::vector<range> others;
+    std::vector<Decoded> instructions;
+
+    [[nodiscard]]
+    bool
+    covers(std::uint16_t address)
+    const noexcept
+    {
+      return code.covers(address)
+          or std::any_of(others.begin(), others.end(), [&](const auto& r){return r.covers(address);});
+    }
+
+    [[nodiscard]]
+    bool
+    overlaps(const range& other)
+    const noexcept
+    {
+      return code.overlaps(other)
+          or std::any_of(others.begin(), others.end(), [&](const auto& r){return r.overlaps(other);});
+    }
+
+    template <typename Fn>
+    void
+    for_each_range(Fn&& fn)
+    const
+    {
+      fn(code);
+      for (const auto& r : others)
+      {
+        fn(r);
+      }
+    }
+  };
+
+  struct page_type final
+  {
+    std::array<const Decoded*, 256> entries;
+    std::array<std::unique_ptr<block>, 256> blocks;
+  };
+
+public:
+
+  block_cache()
+    : starts_{}
+    , pages_{}
+    , code_(65536, 0)
+    , retired_{}
+  {}
+
+  [[nodiscard]]
+  const Decoded*
+  find(std::uint16_t address)
+  const noexcept
+  {
+    const auto& page = starts_[address >> 8];
+    return page ? page->entries[address & 0xff] : nullptr;
+  }
+
+  // Instructions have been decoded from addresses first to last, both included.
+  const Decoded*
+  insert(std::uint16_t first, std::uint16_t last, std::vector<Decoded>&& instructions)
+  {
+    return insert(first, {range{first, last}}, std::move(instructions));
+  }
+
+  // Instructions executed from start have been decoded from ranges, starting with the one of start.
+  // A block already starting at start is replaced.
+  const Decoded*
+  insert(std::uint16_t start, std::vector<range>&& ranges, std::vector<Decoded>&& instructions)
+  {
+    auto& page = starts_[start >> 8];
+    if (not page)
+    {
+      page = std::make_unique<page_type>();
+    }
+    if (const auto& previous = page->blocks[start & 0xff]; previous)
+    {
+      remove(*previous);
+    }
+    auto& b = page->blocks[start & 0xff];
+    const auto code = ranges.front();
+    ranges.erase(ranges.begin());
+    b = std::make_unique<block>(block{start, code, std::move(ranges), std::move(instructions)});
+    page->entries[start & 0xff] = b->instructions.data();
+
+    b->for_each_range([&](const auto& r)
+    {
+      for (auto address = r.first; ; ++address)
+      {
+        ++code_[address];
+        if ((address & 0xff) == 0 or address == r.first)
+        {
+          auto& blocks = pages_[address >> 8];
+          if (std::find(blocks.begin(), blocks.end(), b.get()) == blocks.end())
+          {
+            blocks.push_back(b.get());
+          }
+        }
+        if (address == r.last)
+        {
+          break;
+        }
+      }
+    });
+
+    return b->instructions.data();
+  }
+
+  [[nodiscard]]
+  bool
+  is_code(std::uint16_t address)
+  const noexcept
+  {
+    return code_[address] != 0;
+  }
+
+  // Remove all blocks decoded from address.
+  // Removed blocks are kept alive until the next call to collect(), as they may be executing.
+  void
+  invalidate(std::uint16_t address)
+  {
+    auto& page = pages_[address >> 8];
+    for (auto it = page.begin(); it != page.end();)
+    {
+      if (const auto b = *it; b->covers(address))
+      {
+        remove(*b);
+        it = page.begin();
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  // Remove all blocks decoded from addresses first to last, both included.
+  void
+  invalidate(std::uint16_t first, std::uint16_t last)
+  {
+    const auto addresses = range{first, last};
+    for (auto p = first >> 8; ; p = (p + 1) & 0xff)
+    {
+      auto& page = pages_[p];
+      for (auto it = page.begin(); it != page.end();)
+      {
+        if (const auto b = *it; b->overlaps(addresses))
+        {
+          remove(*b);
+          it = page.begin();
+        }
+        else
+        {
+          ++it;
+        }
+      }
+      if (p == last >> 8)
+      {
+        break;
+      }
+    }
+  }
+
+  // Remove all blocks.
+  void
+  clear()
+  {
+    for (auto& page : starts_)
+    {
+      if (page)
+      {
+        for (auto& b : page->blocks)
+        {
+          if (b)
+          {
+            retired_.push_back(std::move(b));
+          }
+        }
+        page->entries.fill(nullptr);
+      }
+    }
+    for (auto& page : pages_)
+    {
+      page.clear();
+    }
+    std::fill(code_.begin(), code_.end(), 0);
+  }
+
+  // Free blocks which have been invalidated.
+  void
+  collect()
+  noexcept
+  {
+    retired_.clear();
+  }
+
+private:
+
+  void
+  remove(const block& b)
+  {
+    b.for_each_range([&](const auto& r)
+    {
+      for (auto p = r.first >> 8; ; p = (p + 1) & 0xff)
+      {
+        auto& page = pages_[p];
+        page.erase(std::remove(page.begin(), page.end(), &b), page.end());
+        if (p == r.last >> 8)
+        {
+          break;
+        }
+      }
+    });
+
+    b.for_each_range([&](const auto& r)
+    {
+      for (auto address = r.first; ; ++address)
+      {
+        --code_[address];
+        if (address == r.last)
+        {
+          break;
+        }
+      }
+    });
+
+    auto& page = *starts_[b.start >> 8];
+    page.entries[b.start & 0xff] = nullptr;
+    retired_.push_back(std::move(page.blocks[b.start & 0xff]));
+  }
+
+private:
+
+  // Blocks, indexed by the high then the low byte of their start address.
+  std::array<std::unique_ptr<page_type>, 256> starts_;
+
+  // For each page of 256 bytes, the blocks that have been decoded from it.
+  std::array<std::vector<block*>, 256> pages_;
+
+  // For each byte of memory, the number of blocks which have been decoded from it.
+  std::vector<std::uint16_t> code_;
+
+  std::vector<std::unique_ptr<block>> retired_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
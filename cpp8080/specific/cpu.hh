@@ -1,14 +1,27 @@
 #pragma once
 
+#include <algorithm> // any_of, lower_bound, min, sort
+#include <array>
+#include <bitset>
 #include <cstdint>
 #include <iomanip>
 #include <ostream>
 #include <tuple>
+#include <type_traits> // decay_t, is_same_v
+#include <utility>     // declval, exchange, pair
+#include <vector>
 
+#include "cpp8080/meta/decoded.hh"
 #include "cpp8080/meta/make_instructions.hh"
+#include "cpp8080/specific/alu_tables.hh"
+#include "cpp8080/specific/block_cache.hh"
 #include "cpp8080/specific/cpu_fwd.hh"
-#include "cpp8080/specific/halt.hh"
-#include "cpp8080/util/concat.hh"
+#include "cpp8080/specific/idle_loop.hh"
+#include "cpp8080/specific/io_bus.hh"
+#include "cpp8080/specific/lazy_flags.hh"
+#include "cpp8080/specific/memory.hh"
+#include "cpp8080/specific/run_result.hh"
+#include "cpp8080/specific/trace_profile.hh"
 #include "cpp8080/util/hooks.hh"
 #include "cpp8080/util/parity.hh"
 
@@ -22,129 +35,143 @@ class cpu final
 private:
 
   std::uint8_t a_;
-  std::uint8_t b_;
-  std::uint8_t c_;
-  std::uint8_t d_;
-  std::uint8_t e_;
-  std::uint8_t h_;
-  std::uint8_t l_;
+  // Register pairs; their high and low registers are extracted and merged with shifts and masks,
+  // see b() and set().
+  std::uint16_t bc_;
+  std::uint16_t de_;
+  std::uint16_t hl_;
   std::uint16_t sp_;
-  bool cy_;
-  bool p_;
-  bool ac_;
-  bool z_;
-  bool s_;
+  std::uint8_t psw_; // flags, laid out as pushed by push_psw, see psw()
+  std::uint8_t result_; // with lazy flags, sign, zero and parity are those of result_ if lazy_
+  bool lazy_;
   Machine& machine_;
   bool interrupt_;
+  bool interrupt_delay_; // the instruction following ei comes before pending interrupts
+  std::uint8_t pending_; // RST n requested by devices at bit n, until accepted
+  bool halted_; // waiting for an interrupt after hlt
   std::uint64_t cycles_;
   std::uint16_t pc_;
+  std::uint64_t limit_;
+  stop_reason stop_; // why the current run() stops, budget while it goes on
+  std::uint16_t operands_;
+  mutable bool unreadable_read_; // memory outside of readable memory has been read
+  block_cache<meta::decoded_instruction<cpu>> blocks_;
+  std::vector<meta::compiled_block<cpu>> compiled_;
+  trace_profile profile_;
+  std::bitset<256> dirty_pages_; // pages of 256 bytes written since the last checkpoint
 
 private:
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  // The 8-bit registers, as named by instructions.
+  enum class reg {a, b, c, d, e, h, l};
+
+  template <std::uint8_t Opcode, reg R>
   struct i_adda : meta::describe_instruction<Opcode, 4, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.*reg, 0);
+      cpu.adda(cpu.get<R>(), 0);
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_ana : meta::describe_instruction<Opcode, 4, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ana(cpu.*reg);
+      cpu.ana(cpu.get<R>());
+    }
+  };
+
+  template <std::uint8_t Opcode, std::uint16_t cpu::* pair>
+  struct i_dad : meta::describe_instruction<Opcode, 10, 1>
+  {
+    void operator()(cpu& cpu) const noexcept
+    {
+      const auto res = std::uint32_t{cpu.hl_} + cpu.*pair;
+      cpu.hl_ = static_cast<std::uint16_t>(res);
+      cpu.set_carry(res > 0xffff);
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_dcr : meta::describe_instruction<Opcode, 5, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg = cpu.dcr(cpu.*reg);
+      cpu.set<R>(cpu.dcr(cpu.get<R>()));
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg1, auto cpu::* reg2>
+  template <std::uint8_t Opcode, std::uint16_t cpu::* pair>
   struct i_dcx : meta::describe_instruction<Opcode, 5, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg1 -= 1;
-      if (cpu.*reg1 == 0x00ff)
-      {
-        cpu.*reg2 -= 1;
-      }
+      cpu.*pair -= 1;
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_inr : meta::describe_instruction<Opcode, 5, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg = cpu.inr(cpu.*reg);
+      cpu.set<R>(cpu.inr(cpu.get<R>()));
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg1, auto cpu::* reg2>
+  template <std::uint8_t Opcode, std::uint16_t cpu::* pair>
   struct i_inx : meta::describe_instruction<Opcode, 5, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg1 += 1;
-      if (cpu.*reg1 == 0)
-      {
-        cpu.*reg2 += 1;
-      }
+      cpu.*pair += 1;
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg1, auto cpu::* reg2>
+  template <std::uint8_t Opcode, std::uint16_t cpu::* pair>
   struct i_lxi : meta::describe_instruction<Opcode, 10, 3>
   {
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
-      std::tie(cpu.*reg1, cpu.*reg2) = cpu.operands();
+      cpu.*pair = cpu.operands_;
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg1, auto cpu::* reg2>
+  template <std::uint8_t Opcode, reg To, reg From>
   struct i_mov : meta::describe_instruction<Opcode, 5, 1>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg1 = cpu.*reg2;
+      cpu.set<To>(cpu.get<From>());
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_mov_m : meta::describe_instruction<Opcode, 7, 1>
   {
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.*reg = cpu.read_hl();
+      cpu.set<R>(cpu.read_hl());
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_mov_to_m : meta::describe_instruction<Opcode, 7, 1>
   {
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.write_hl(cpu.*reg);
+      cpu.write_hl(cpu.get<R>());
     }
   };
 
-  template <std::uint8_t Opcode, auto cpu::* reg>
+  template <std::uint8_t Opcode, reg R>
   struct i_mvi : meta::describe_instruction<Opcode, 7, 2>
   {
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.*reg = cpu.op1();
+      cpu.set<R>(cpu.op1());
     }
   };
 
@@ -153,9 +180,9 @@ private:
   {
     static constexpr auto name = "unimplemented";
 
-    void operator()(const cpu&) const
+    void operator()(cpu& cpu) const noexcept
     {
-      throw std::runtime_error{util::concat("Unimplemented instruction ", std::hex, +Opcode)};
+      cpu.stop(stop_reason::unimplemented);
     }
   };
 
@@ -171,28 +198,37 @@ private:
   {
     static constexpr auto name = "hlt";
 
-    void operator()(cpu&) const
+    // Wait for an interrupt, or stop for good if interrupts are disabled.
+    void operator()(cpu& cpu) const noexcept
     {
-      throw halt{"HLT"};
+      if (cpu.interrupt_enabled())
+      {
+        cpu.halted_ = true;
+        cpu.limit_ = 0;
+      }
+      else
+      {
+        cpu.stop(stop_reason::halted);
+      }
     }
   };
 
-  struct lxi_b : i_lxi<0x01, &cpu::c_, &cpu::b_> {static constexpr auto name = "lxi_b";};
+  struct lxi_b : i_lxi<0x01, &cpu::bc_> {static constexpr auto name = "lxi_b";};
 
   struct stax_b : meta::describe_instruction<0x02, 7, 1>
   {
     static constexpr auto name = "stax_b";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.memory_write_byte(cpu.bc(), cpu.a_);
     }
   };
 
-  struct inx_b : i_inx<0x03, &cpu::c_, &cpu::b_> {static constexpr auto name = "inx_b";};
-  struct inr_b : i_inr<0x04, &cpu::b_> {static constexpr auto name = "inr_b";};
-  struct dcr_b : i_dcr<0x05, &cpu::b_> {static constexpr auto name = "dcr_b";};
-  struct mvi_b : i_mvi<0x06, &cpu::b_> {static constexpr auto name = "mvi_b";};
+  struct inx_b : i_inx<0x03, &cpu::bc_> {static constexpr auto name = "inx_b";};
+  struct inr_b : i_inr<0x04, reg::b> {static constexpr auto name = "inr_b";};
+  struct dcr_b : i_dcr<0x05, reg::b> {static constexpr auto name = "dcr_b";};
+  struct mvi_b : i_mvi<0x06, reg::b> {static constexpr auto name = "mvi_b";};
 
   struct rlc : meta::describe_instruction<0x07, 4, 1>
   {
@@ -202,37 +238,26 @@ private:
     {
       const auto x = cpu.a_;
       cpu.a_ = ((x & 0x80) >> 7) | (x << 1);
-      cpu.cy_ = (0x80 == (x & 0x80));
+      cpu.set_carry(0x80 == (x & 0x80));
     }
   };
 
-  struct dad_b : meta::describe_instruction<0x09, 10, 1>
-  {
-    static constexpr auto name = "dad_b";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      const std::uint32_t res = cpu.hl() + cpu.bc();
-      cpu.h_= (res & 0xff00) >> 8;
-      cpu.l_= res & 0x00ff;
-      cpu.cy_ = ((res & 0xffff0000) != 0);
-    }
-  };
+  struct dad_b : i_dad<0x09, &cpu::bc_> {static constexpr auto name = "dad_b";};
 
   struct ldax_b : meta::describe_instruction<0x0a, 7, 1>
   {
     static constexpr auto name = "ldax_b";
 
-    void operator()(cpu& cpu) const noexcept
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.a_ = cpu.memory_read_byte(cpu.bc());
     }
   };
 
-  struct dcx_b : i_dcx<0x0b, &cpu::c_, &cpu::b_> {static constexpr auto name = "dcx_b";};
-  struct inr_c : i_inr<0x0c, &cpu::c_> {static constexpr auto name = "inr_c";};
-  struct dcr_c : i_dcr<0x0d, &cpu::c_> {static constexpr auto name = "dcr_b";};
-  struct mvi_c : i_mvi<0x0e, &cpu::c_> {static constexpr auto name = "mvi_c";};
+  struct dcx_b : i_dcx<0x0b, &cpu::bc_> {static constexpr auto name = "dcx_b";};
+  struct inr_c : i_inr<0x0c, reg::c> {static constexpr auto name = "inr_c";};
+  struct dcr_c : i_dcr<0x0d, reg::c> {static constexpr auto name = "dcr_b";};
+  struct mvi_c : i_mvi<0x0e, reg::c> {static constexpr auto name = "mvi_c";};
 
   struct rrc : meta::describe_instruction<0x0f, 4, 1>
   {
@@ -242,26 +267,26 @@ private:
     {
       const auto x = cpu.a_;
       cpu.a_ = ((x & 1) << 7) | (x >> 1);
-      cpu.cy_ = (1 == (x & 1));
+      cpu.set_carry(1 == (x & 1));
     }
   };
 
-  struct lxi_d : i_lxi<0x11, &cpu::e_, &cpu::d_> {static constexpr auto name = "lxi_d";};
+  struct lxi_d : i_lxi<0x11, &cpu::de_> {static constexpr auto name = "lxi_d";};
 
   struct stax_d : meta::describe_instruction<0x12, 7, 1>
   {
     static constexpr auto name = "stax_d";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.memory_write_byte(cpu.de(), cpu.a_);
     }
   };
 
-  struct inx_d : i_inx<0x13, &cpu::e_, &cpu::d_> {static constexpr auto name = "inx_b";};
-  struct inr_d : i_inr<0x14, &cpu::d_> {static constexpr auto name = "inr_d";};
-  struct dcr_d : i_dcr<0x15, &cpu::d_> {static constexpr auto name = "dcr_b";};
-  struct mvi_d : i_mvi<0x16, &cpu::d_> {static constexpr auto name = "mvi_d";};
+  struct inx_d : i_inx<0x13, &cpu::de_> {static constexpr auto name = "inx_b";};
+  struct inr_d : i_inr<0x14, reg::d> {static constexpr auto name = "inr_d";};
+  struct dcr_d : i_dcr<0x15, reg::d> {static constexpr auto name = "dcr_b";};
+  struct mvi_d : i_mvi<0x16, reg::d> {static constexpr auto name = "mvi_d";};
 
   struct ral : meta::describe_instruction<0x17, 4, 1>
   {
@@ -270,39 +295,28 @@ private:
     void operator()(cpu& cpu) const noexcept
     {
       const auto a = cpu.a_;
-      cpu.a_ = cpu.cy_ | (a << 1);
-      cpu.cy_ = (0x80 == (a & 0x80));
+      cpu.a_ = cpu.cy() | (a << 1);
+      cpu.set_carry(0x80 == (a & 0x80));
     }
   };
 
-  struct dad_d : meta::describe_instruction<0x19, 10, 1>
-  {
-    static constexpr auto name = "dad_d";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      const std::uint32_t res = cpu.hl() + cpu.de();
-      cpu.h_= (res & 0xff00) >> 8;
-      cpu.l_= res & 0x00ff;
-      cpu.cy_ = ((res & 0xffff0000) != 0);
-    }
-  };
+  struct dad_d : i_dad<0x19, &cpu::de_> {static constexpr auto name = "dad_d";};
 
   struct ldax_d : meta::describe_instruction<0x1a, 7, 1>
   {
     static constexpr auto name = "ldax_d";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.a_ = cpu.memory_read_byte(cpu.de());
     }
   };
 
-  struct dcx_d : i_dcx<0x1b, &cpu::e_, &cpu::d_> {static constexpr auto name = "dcx_d";};
+  struct dcx_d : i_dcx<0x1b, &cpu::de_> {static constexpr auto name = "dcx_d";};
 
-  struct inr_e : i_inr<0x1c, &cpu::e_> {static constexpr auto name = "inr_e";};
-  struct dcr_e : i_dcr<0x1d, &cpu::e_> {static constexpr auto name = "dcr_e";};
-  struct mvi_e : i_mvi<0x1e, &cpu::e_> {static constexpr auto name = "mvi_e";};
+  struct inr_e : i_inr<0x1c, reg::e> {static constexpr auto name = "inr_e";};
+  struct dcr_e : i_dcr<0x1d, reg::e> {static constexpr auto name = "dcr_e";};
+  struct mvi_e : i_mvi<0x1e, reg::e> {static constexpr auto name = "mvi_e";};
 
   struct rar : meta::describe_instruction<0x1f, 4, 1>
   {
@@ -311,29 +325,27 @@ private:
     void operator()(cpu& cpu) const noexcept
     {
       const auto a = cpu.a_;
-      cpu.a_ = (cpu.cy_ << 7) | (a >> 1);
-      cpu.cy_ = (1 == (a & 1));
+      cpu.a_ = (cpu.cy() << 7) | (a >> 1);
+      cpu.set_carry(1 == (a & 1));
     }
   };
 
-  struct lxi_h : i_lxi<0x21, &cpu::l_, &cpu::h_> {static constexpr auto name = "lxi_b";};
+  struct lxi_h : i_lxi<0x21, &cpu::hl_> {static constexpr auto name = "lxi_b";};
 
   struct shld : meta::describe_instruction<0x22, 16, 3>
   {
     static constexpr auto name = "shld";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      const std::uint16_t offset = cpu.operands_word();
-      cpu.memory_write_byte(offset, cpu.l_);
-      cpu.memory_write_byte(offset + 1, cpu.h_);
+      cpu.memory_write_word(cpu.operands_word(), cpu.hl_);
     }
   };
 
-  struct inx_h : i_inx<0x23, &cpu::l_, &cpu::h_> {static constexpr auto name = "inx_h";};
-  struct inr_h : i_inr<0x24, &cpu::h_> {static constexpr auto name = "inr_h";};
-  struct dcr_h : i_dcr<0x25, &cpu::h_> {static constexpr auto name = "dcr_h";};
-  struct mvi_h : i_mvi<0x26, &cpu::h_> {static constexpr auto name = "mvi_h";};
+  struct inx_h : i_inx<0x23, &cpu::hl_> {static constexpr auto name = "inx_h";};
+  struct inr_h : i_inr<0x24, reg::h> {static constexpr auto name = "inr_h";};
+  struct dcr_h : i_dcr<0x25, reg::h> {static constexpr auto name = "dcr_h";};
+  struct mvi_h : i_mvi<0x26, reg::h> {static constexpr auto name = "mvi_h";};
 
   struct daa : meta::describe_instruction<0x27, 4, 1>
   {
@@ -341,104 +353,64 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      auto cy = cpu.cy_;
-      auto value_to_add = std::uint8_t{0};
-
-      const std::uint8_t lsb = cpu.a_ & 0x0f;
-      const std::uint8_t msb = cpu.a_ >> 4;
-
-      if (cpu.ac_ or lsb > 9)
+      if constexpr (has_alu_tables)
       {
-        value_to_add += 0x06;
+        cpu.set_a_psw(alu_tables::decimal_adjustments[cpu.ac() << 9 | cpu.cy() << 8 | cpu.a_]);
       }
-      if (cpu.cy_ or msb > 9 or (msb >= 9 and lsb > 9))
+      else
       {
-        value_to_add += 0x60;
-        cy = true;
+        cpu.set_a_psw(decimal_adjust(cpu.a_, cpu.ac(), cpu.cy()));
       }
-      cpu.adda(value_to_add, 0);
-      cpu.p_ = util::parity(cpu.a_);
-      cpu.cy_ = cy;
-
     }
   };
 
-  struct dad_h : meta::describe_instruction<0x29, 10, 1>
-  {
-    static constexpr auto name = "dad_h";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      const std::uint32_t res = 2 * cpu.hl();
-      cpu.h_= (res & 0xff00) >> 8;
-      cpu.l_= res & 0x00ff;
-      cpu.cy_ = ((res & 0xffff0000) != 0);
-    }
-  };
+  struct dad_h : i_dad<0x29, &cpu::hl_> {static constexpr auto name = "dad_h";};
 
   struct lhld : meta::describe_instruction<0x2a, 16, 3>
   {
     static constexpr auto name = "lhld";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      const std::uint16_t offset = cpu.operands_word();
-      cpu.l_= cpu.memory_read_byte(offset);
-      cpu.h_= cpu.memory_read_byte(offset + 1);
+      cpu.hl_ = cpu.memory_read_word(cpu.operands_word());
     }
   };
 
-  struct dcx_h : i_dcx<0x2b, &cpu::l_, &cpu::h_> {static constexpr auto name = "dcx_b";};
+  struct dcx_h : i_dcx<0x2b, &cpu::hl_> {static constexpr auto name = "dcx_b";};
 
-  struct inr_l : i_inr<0x2c, &cpu::l_> {static constexpr auto name = "inr_l";};
-  struct dcr_l : i_dcr<0x2d, &cpu::l_> {static constexpr auto name = "dcr_l";};
-  struct mvi_l : i_mvi<0x2e, &cpu::l_> {static constexpr auto name = "mvi_l";};
+  struct inr_l : i_inr<0x2c, reg::l> {static constexpr auto name = "inr_l";};
+  struct dcr_l : i_dcr<0x2d, reg::l> {static constexpr auto name = "dcr_l";};
+  struct mvi_l : i_mvi<0x2e, reg::l> {static constexpr auto name = "mvi_l";};
 
   struct cma : meta::describe_instruction<0x2f, 4, 1>
   {
     static constexpr auto name = "cma";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
       cpu.a_ ^= 0xff;
     }
   };
 
-  struct lxi_sp : meta::describe_instruction<0x31, 10, 3>
-  {
-    static constexpr auto name = "lxi_sp";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      cpu.sp_ = cpu.operands_word();
-    }
-  };
+  struct lxi_sp : i_lxi<0x31, &cpu::sp_> {static constexpr auto name = "lxi_sp";};
 
   struct sta : meta::describe_instruction<0x32, 13, 3>
   {
     static constexpr auto name = "sta";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.memory_write_byte(cpu.operands_word(), cpu.a_);
     }
   };
 
-  struct inx_sp : meta::describe_instruction<0x33, 5, 1>
-  {
-    static constexpr auto name = "inx_sp";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      cpu.sp_ += 1;
-    }
-  };
+  struct inx_sp : i_inx<0x33, &cpu::sp_> {static constexpr auto name = "inx_sp";};
 
   struct inr_m : meta::describe_instruction<0x34, 10, 1>
   {
     static constexpr auto name = "inr_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       const auto res = cpu.inr(cpu.read_hl());
       cpu.write_hl(res);
@@ -449,7 +421,7 @@ private:
   {
     static constexpr auto name = "dcr_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       const auto res = cpu.dcr(cpu.read_hl());
       cpu.write_hl(res);
@@ -460,7 +432,7 @@ private:
   {
     static constexpr auto name = "mvi_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.write_hl(cpu.op1());
     }
@@ -470,49 +442,30 @@ private:
   {
     static constexpr auto name = "stc";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
-      cpu.cy_ = true;
+      cpu.set_carry(true);
     }
   };
 
-  struct dad_sp : meta::describe_instruction<0x39, 10, 1>
-  {
-    static constexpr auto name = "dad_sp";
-
-    void operator()(cpu& cpu) const
-    {
-      const std::uint32_t res = cpu.hl() + cpu.sp_;
-      cpu.h_= (res & 0xff00) >> 8;
-      cpu.l_= res & 0x00ff;
-      cpu.cy_ = ((res & 0xffff0000) > 0);
-    }
-  };
+  struct dad_sp : i_dad<0x39, &cpu::sp_> {static constexpr auto name = "dad_sp";};
 
   struct lda : meta::describe_instruction<0x3a, 13, 3>
   {
     static constexpr auto name = "lda";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       const std::uint16_t offset = cpu.operands_word();
       cpu.a_ = cpu.memory_read_byte(offset);
     }
   };
 
-  struct dcx_sp : meta::describe_instruction<0x3b, 5, 1>
-  {
-    static constexpr auto name = "dcx_sp";
-
-    void operator()(cpu& cpu) const noexcept
-    {
-      cpu.sp_ -= 1;
-    }
-  };
+  struct dcx_sp : i_dcx<0x3b, &cpu::sp_> {static constexpr auto name = "dcx_sp";};
 
-  struct inr_a : i_inr<0x3c, &cpu::a_> {static constexpr auto name = "inr_a";};
-  struct dcr_a : i_dcr<0x3d, &cpu::a_> {static constexpr auto name = "dcr_a";};
-  struct mvi_a : i_mvi<0x3e, &cpu::a_> {static constexpr auto name = "mvi_a";};
+  struct inr_a : i_inr<0x3c, reg::a> {static constexpr auto name = "inr_a";};
+  struct dcr_a : i_dcr<0x3d, reg::a> {static constexpr auto name = "dcr_a";};
+  struct mvi_a : i_mvi<0x3e, reg::a> {static constexpr auto name = "mvi_a";};
 
   struct cmc : meta::describe_instruction<0x3f, 4, 1>
   {
@@ -520,86 +473,86 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cy_ = not(cpu.cy_);
-    }
-  };
-
-  struct mov_b_b : i_mov<0x40, &cpu::b_, &cpu::b_> {static constexpr auto name = "mov_b_b";};
-  struct mov_b_c : i_mov<0x41, &cpu::b_, &cpu::c_> {static constexpr auto name = "mov_b_c";};
-  struct mov_b_d : i_mov<0x42, &cpu::b_, &cpu::d_> {static constexpr auto name = "mov_b_d";};
-  struct mov_b_e : i_mov<0x43, &cpu::b_, &cpu::e_> {static constexpr auto name = "mov_b_e";};
-  struct mov_b_h : i_mov<0x44, &cpu::b_, &cpu::h_> {static constexpr auto name = "mov_b_h";};
-  struct mov_b_l : i_mov<0x45, &cpu::b_, &cpu::l_> {static constexpr auto name = "mov_b_l";};
-  struct mov_b_m : i_mov_m<0x46, &cpu::b_> {static constexpr auto name = "mov_b_m";};
-  struct mov_b_a : i_mov<0x47, &cpu::b_, &cpu::a_> {static constexpr auto name = "mov_b_a";};
-  struct mov_c_b : i_mov<0x48, &cpu::c_, &cpu::b_> {static constexpr auto name = "mov_c_b";};
-  struct mov_c_c : i_mov<0x49, &cpu::c_, &cpu::c_> {static constexpr auto name = "mov_c_c";};
-  struct mov_c_d : i_mov<0x4a, &cpu::c_, &cpu::d_> {static constexpr auto name = "mov_c_d";};
-  struct mov_c_e : i_mov<0x4b, &cpu::c_, &cpu::e_> {static constexpr auto name = "mov_c_e";};
-  struct mov_c_h : i_mov<0x4c, &cpu::c_, &cpu::h_> {static constexpr auto name = "mov_c_h";};
-  struct mov_c_l : i_mov<0x4d, &cpu::c_, &cpu::l_> {static constexpr auto name = "mov_c_l";};
-  struct mov_c_m : i_mov_m<0x4e, &cpu::c_> {static constexpr auto name = "mov_c_m";};
-  struct mov_c_a : i_mov<0x4f, &cpu::c_, &cpu::a_> {static constexpr auto name = "mov_c_a";};
-  struct mov_d_b : i_mov<0x50, &cpu::d_, &cpu::b_> {static constexpr auto name = "mov_d_b";};
-  struct mov_d_c : i_mov<0x51, &cpu::d_, &cpu::c_> {static constexpr auto name = "mov_d_c";};
-  struct mov_d_d : i_mov<0x52, &cpu::b_, &cpu::b_> {static constexpr auto name = "mov_d_d";};
-  struct mov_d_e : i_mov<0x53, &cpu::d_, &cpu::e_> {static constexpr auto name = "mov_d_e";};
-  struct mov_d_h : i_mov<0x54, &cpu::d_, &cpu::h_> {static constexpr auto name = "mov_d_h";};
-  struct mov_d_l : i_mov<0x55, &cpu::d_, &cpu::l_> {static constexpr auto name = "mov_d_l";};
-  struct mov_d_m : i_mov_m<0x56, &cpu::d_> {static constexpr auto name = "mov_d_m";};
-  struct mov_d_a : i_mov<0x57, &cpu::d_, &cpu::a_> {static constexpr auto name = "mov_d_a";};
-  struct mov_e_b : i_mov<0x58, &cpu::e_, &cpu::b_> {static constexpr auto name = "mov_e_b";};
-  struct mov_e_c : i_mov<0x59, &cpu::e_, &cpu::c_> {static constexpr auto name = "mov_e_c";};
-  struct mov_e_d : i_mov<0x5a, &cpu::e_, &cpu::d_> {static constexpr auto name = "mov_e_d";};
-  struct mov_e_e : i_mov<0x5b, &cpu::e_, &cpu::e_> {static constexpr auto name = "mov_e_e";};
-  struct mov_e_h : i_mov<0x5c, &cpu::e_, &cpu::h_> {static constexpr auto name = "mov_e_h";};
-  struct mov_e_l : i_mov<0x5d, &cpu::e_, &cpu::l_> {static constexpr auto name = "mov_e_l";};
-  struct mov_e_m : i_mov_m<0x5e, &cpu::e_> {static constexpr auto name = "mov_e_m";};
-  struct mov_e_a : i_mov<0x5f, &cpu::e_, &cpu::a_> {static constexpr auto name = "mov_e_a";};
-  struct mov_h_b : i_mov<0x60, &cpu::h_, &cpu::b_> {static constexpr auto name = "mov_h_b";};
-  struct mov_h_c : i_mov<0x61, &cpu::h_, &cpu::c_> {static constexpr auto name = "mov_h_c";};
-  struct mov_h_d : i_mov<0x62, &cpu::h_, &cpu::d_> {static constexpr auto name = "mov_h_d";};
-  struct mov_h_e : i_mov<0x63, &cpu::h_, &cpu::e_> {static constexpr auto name = "mov_h_e";};
-  struct mov_h_h : i_mov<0x64, &cpu::h_, &cpu::h_> {static constexpr auto name = "mov_h_h";};
-  struct mov_h_l : i_mov<0x65, &cpu::h_, &cpu::l_> {static constexpr auto name = "mov_h_l";};
-  struct mov_h_m : i_mov_m<0x66, &cpu::h_> {static constexpr auto name = "mov_h_m";};
-  struct mov_h_a : i_mov<0x67, &cpu::h_, &cpu::a_> {static constexpr auto name = "mov_h_a";};
-  struct mov_l_b : i_mov<0x68, &cpu::l_, &cpu::b_> {static constexpr auto name = "mov_l_b";};
-  struct mov_l_c : i_mov<0x69, &cpu::l_, &cpu::c_> {static constexpr auto name = "mov_l_c";};
-  struct mov_l_d : i_mov<0x6a, &cpu::l_, &cpu::d_> {static constexpr auto name = "mov_l_d";};
-  struct mov_l_e : i_mov<0x6b, &cpu::l_, &cpu::e_> {static constexpr auto name = "mov_l_e";};
-  struct mov_l_h : i_mov<0x6c, &cpu::l_, &cpu::h_> {static constexpr auto name = "mov_l_h";};
-  struct mov_l_l : i_mov<0x40, &cpu::l_, &cpu::l_> {static constexpr auto name = "mov_l_l";};
-  struct mov_l_m : i_mov_m<0x6e, &cpu::l_> {static constexpr auto name = "mov_l_m";};
-  struct mov_l_a : i_mov<0x6f, &cpu::l_, &cpu::a_> {static constexpr auto name = "mov_l_a";};
-  struct mov_m_b : i_mov_to_m<0x70, &cpu::b_> {static constexpr auto name = "mov_m_b";};
-  struct mov_m_c : i_mov_to_m<0x71, &cpu::c_> {static constexpr auto name = "mov_m_c";};
-  struct mov_m_d : i_mov_to_m<0x72, &cpu::d_> {static constexpr auto name = "mov_m_d";};
-  struct mov_m_e : i_mov_to_m<0x73, &cpu::e_> {static constexpr auto name = "mov_m_e";};
-  struct mov_m_h : i_mov_to_m<0x74, &cpu::h_> {static constexpr auto name = "mov_m_h";};
-  struct mov_m_l : i_mov_to_m<0x75, &cpu::l_> {static constexpr auto name = "mov_m_l";};
-  struct mov_m_a : i_mov_to_m<0x77, &cpu::a_> {static constexpr auto name = "mov_m_a";};
-  struct mov_a_b : i_mov<0x78, &cpu::a_, &cpu::b_> {static constexpr auto name = "mov_a_b";};
-  struct mov_a_c : i_mov<0x79, &cpu::a_, &cpu::c_> {static constexpr auto name = "mov_a_c";};
-  struct mov_a_d : i_mov<0x7a, &cpu::a_, &cpu::d_> {static constexpr auto name = "mov_a_d";};
-  struct mov_a_e : i_mov<0x7b, &cpu::a_, &cpu::e_> {static constexpr auto name = "mov_a_e";};
-  struct mov_a_h : i_mov<0x7c, &cpu::a_, &cpu::h_> {static constexpr auto name = "mov_a_h";};
-  struct mov_a_l : i_mov<0x7d, &cpu::a_, &cpu::l_> {static constexpr auto name = "mov_a_l";};
-  struct mov_a_m : i_mov_m<0x7e, &cpu::a_> {static constexpr auto name = "mov_a_m";};
-  struct mov_a_a : i_mov<0x7f, &cpu::a_, &cpu::a_> {static constexpr auto name = "mov_a_a";};
-
-  struct add_b : i_adda<0x80, &cpu::b_>{static constexpr auto name = "add_b";};
-  struct add_c : i_adda<0x81, &cpu::c_>{static constexpr auto name = "add_c";};
-  struct add_d : i_adda<0x82, &cpu::d_>{static constexpr auto name = "add_d";};
-  struct add_e : i_adda<0x83, &cpu::e_>{static constexpr auto name = "add_e";};
-  struct add_h : i_adda<0x84, &cpu::h_>{static constexpr auto name = "add_h";};
-  struct add_l : i_adda<0x85, &cpu::l_>{static constexpr auto name = "add_l";};
+      cpu.set_carry(not cpu.cy());
+    }
+  };
+
+  struct mov_b_b : i_mov<0x40, reg::b, reg::b> {static constexpr auto name = "mov_b_b";};
+  struct mov_b_c : i_mov<0x41, reg::b, reg::c> {static constexpr auto name = "mov_b_c";};
+  struct mov_b_d : i_mov<0x42, reg::b, reg::d> {static constexpr auto name = "mov_b_d";};
+  struct mov_b_e : i_mov<0x43, reg::b, reg::e> {static constexpr auto name = "mov_b_e";};
+  struct mov_b_h : i_mov<0x44, reg::b, reg::h> {static constexpr auto name = "mov_b_h";};
+  struct mov_b_l : i_mov<0x45, reg::b, reg::l> {static constexpr auto name = "mov_b_l";};
+  struct mov_b_m : i_mov_m<0x46, reg::b> {static constexpr auto name = "mov_b_m";};
+  struct mov_b_a : i_mov<0x47, reg::b, reg::a> {static constexpr auto name = "mov_b_a";};
+  struct mov_c_b : i_mov<0x48, reg::c, reg::b> {static constexpr auto name = "mov_c_b";};
+  struct mov_c_c : i_mov<0x49, reg::c, reg::c> {static constexpr auto name = "mov_c_c";};
+  struct mov_c_d : i_mov<0x4a, reg::c, reg::d> {static constexpr auto name = "mov_c_d";};
+  struct mov_c_e : i_mov<0x4b, reg::c, reg::e> {static constexpr auto name = "mov_c_e";};
+  struct mov_c_h : i_mov<0x4c, reg::c, reg::h> {static constexpr auto name = "mov_c_h";};
+  struct mov_c_l : i_mov<0x4d, reg::c, reg::l> {static constexpr auto name = "mov_c_l";};
+  struct mov_c_m : i_mov_m<0x4e, reg::c> {static constexpr auto name = "mov_c_m";};
+  struct mov_c_a : i_mov<0x4f, reg::c, reg::a> {static constexpr auto name = "mov_c_a";};
+  struct mov_d_b : i_mov<0x50, reg::d, reg::b> {static constexpr auto name = "mov_d_b";};
+  struct mov_d_c : i_mov<0x51, reg::d, reg::c> {static constexpr auto name = "mov_d_c";};
+  struct mov_d_d : i_mov<0x52, reg::b, reg::b> {static constexpr auto name = "mov_d_d";};
+  struct mov_d_e : i_mov<0x53, reg::d, reg::e> {static constexpr auto name = "mov_d_e";};
+  struct mov_d_h : i_mov<0x54, reg::d, reg::h> {static constexpr auto name = "mov_d_h";};
+  struct mov_d_l : i_mov<0x55, reg::d, reg::l> {static constexpr auto name = "mov_d_l";};
+  struct mov_d_m : i_mov_m<0x56, reg::d> {static constexpr auto name = "mov_d_m";};
+  struct mov_d_a : i_mov<0x57, reg::d, reg::a> {static constexpr auto name = "mov_d_a";};
+  struct mov_e_b : i_mov<0x58, reg::e, reg::b> {static constexpr auto name = "mov_e_b";};
+  struct mov_e_c : i_mov<0x59, reg::e, reg::c> {static constexpr auto name = "mov_e_c";};
+  struct mov_e_d : i_mov<0x5a, reg::e, reg::d> {static constexpr auto name = "mov_e_d";};
+  struct mov_e_e : i_mov<0x5b, reg::e, reg::e> {static constexpr auto name = "mov_e_e";};
+  struct mov_e_h : i_mov<0x5c, reg::e, reg::h> {static constexpr auto name = "mov_e_h";};
+  struct mov_e_l : i_mov<0x5d, reg::e, reg::l> {static constexpr auto name = "mov_e_l";};
+  struct mov_e_m : i_mov_m<0x5e, reg::e> {static constexpr auto name = "mov_e_m";};
+  struct mov_e_a : i_mov<0x5f, reg::e, reg::a> {static constexpr auto name = "mov_e_a";};
+  struct mov_h_b : i_mov<0x60, reg::h, reg::b> {static constexpr auto name = "mov_h_b";};
+  struct mov_h_c : i_mov<0x61, reg::h, reg::c> {static constexpr auto name = "mov_h_c";};
+  struct mov_h_d : i_mov<0x62, reg::h, reg::d> {static constexpr auto name = "mov_h_d";};
+  struct mov_h_e : i_mov<0x63, reg::h, reg::e> {static constexpr auto name = "mov_h_e";};
+  struct mov_h_h : i_mov<0x64, reg::h, reg::h> {static constexpr auto name = "mov_h_h";};
+  struct mov_h_l : i_mov<0x65, reg::h, reg::l> {static constexpr auto name = "mov_h_l";};
+  struct mov_h_m : i_mov_m<0x66, reg::h> {static constexpr auto name = "mov_h_m";};
+  struct mov_h_a : i_mov<0x67, reg::h, reg::a> {static constexpr auto name = "mov_h_a";};
+  struct mov_l_b : i_mov<0x68, reg::l, reg::b> {static constexpr auto name = "mov_l_b";};
+  struct mov_l_c : i_mov<0x69, reg::l, reg::c> {static constexpr auto name = "mov_l_c";};
+  struct mov_l_d : i_mov<0x6a, reg::l, reg::d> {static constexpr auto name = "mov_l_d";};
+  struct mov_l_e : i_mov<0x6b, reg::l, reg::e> {static constexpr auto name = "mov_l_e";};
+  struct mov_l_h : i_mov<0x6c, reg::l, reg::h> {static constexpr auto name = "mov_l_h";};
+  struct mov_l_l : i_mov<0x40, reg::l, reg::l> {static constexpr auto name = "mov_l_l";};
+  struct mov_l_m : i_mov_m<0x6e, reg::l> {static constexpr auto name = "mov_l_m";};
+  struct mov_l_a : i_mov<0x6f, reg::l, reg::a> {static constexpr auto name = "mov_l_a";};
+  struct mov_m_b : i_mov_to_m<0x70, reg::b> {static constexpr auto name = "mov_m_b";};
+  struct mov_m_c : i_mov_to_m<0x71, reg::c> {static constexpr auto name = "mov_m_c";};
+  struct mov_m_d : i_mov_to_m<0x72, reg::d> {static constexpr auto name = "mov_m_d";};
+  struct mov_m_e : i_mov_to_m<0x73, reg::e> {static constexpr auto name = "mov_m_e";};
+  struct mov_m_h : i_mov_to_m<0x74, reg::h> {static constexpr auto name = "mov_m_h";};
+  struct mov_m_l : i_mov_to_m<0x75, reg::l> {static constexpr auto name = "mov_m_l";};
+  struct mov_m_a : i_mov_to_m<0x77, reg::a> {static constexpr auto name = "mov_m_a";};
+  struct mov_a_b : i_mov<0x78, reg::a, reg::b> {static constexpr auto name = "mov_a_b";};
+  struct mov_a_c : i_mov<0x79, reg::a, reg::c> {static constexpr auto name = "mov_a_c";};
+  struct mov_a_d : i_mov<0x7a, reg::a, reg::d> {static constexpr auto name = "mov_a_d";};
+  struct mov_a_e : i_mov<0x7b, reg::a, reg::e> {static constexpr auto name = "mov_a_e";};
+  struct mov_a_h : i_mov<0x7c, reg::a, reg::h> {static constexpr auto name = "mov_a_h";};
+  struct mov_a_l : i_mov<0x7d, reg::a, reg::l> {static constexpr auto name = "mov_a_l";};
+  struct mov_a_m : i_mov_m<0x7e, reg::a> {static constexpr auto name = "mov_a_m";};
+  struct mov_a_a : i_mov<0x7f, reg::a, reg::a> {static constexpr auto name = "mov_a_a";};
+
+  struct add_b : i_adda<0x80, reg::b>{static constexpr auto name = "add_b";};
+  struct add_c : i_adda<0x81, reg::c>{static constexpr auto name = "add_c";};
+  struct add_d : i_adda<0x82, reg::d>{static constexpr auto name = "add_d";};
+  struct add_e : i_adda<0x83, reg::e>{static constexpr auto name = "add_e";};
+  struct add_h : i_adda<0x84, reg::h>{static constexpr auto name = "add_h";};
+  struct add_l : i_adda<0x85, reg::l>{static constexpr auto name = "add_l";};
   struct add_m : meta::describe_instruction<0x86, 7, 1>
   {
     static constexpr auto name = "add_m";
-    void operator()(cpu& cpu) const {cpu.adda(cpu.read_hl(), 0);}
+    void operator()(cpu& cpu) const noexcept(memory_noexcept) {cpu.adda(cpu.read_hl(), 0);}
   };
-  struct add_a : i_adda<0x87, &cpu::a_>{static constexpr auto name = "add_a";};
+  struct add_a : i_adda<0x87, reg::a>{static constexpr auto name = "add_a";};
 
   struct adc_b : meta::describe_instruction<0x88, 4, 1>
   {
@@ -607,7 +560,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.b_, cpu.cy_);
+      cpu.adda(cpu.b(), cpu.cy());
     }
   };
 
@@ -617,7 +570,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.c_, cpu.cy_);
+      cpu.adda(cpu.c(), cpu.cy());
     }
   };
 
@@ -627,7 +580,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.d_, cpu.cy_);
+      cpu.adda(cpu.d(), cpu.cy());
     }
   };
 
@@ -637,7 +590,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.e_, cpu.cy_);
+      cpu.adda(cpu.e(), cpu.cy());
     }
   };
 
@@ -647,7 +600,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.h_, cpu.cy_);
+      cpu.adda(cpu.h(), cpu.cy());
     }
   };
 
@@ -657,7 +610,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.l_, cpu.cy_);
+      cpu.adda(cpu.l(), cpu.cy());
     }
   };
 
@@ -665,9 +618,9 @@ private:
   {
     static constexpr auto name = "adc_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.adda(cpu.read_hl(), cpu.cy_);
+      cpu.adda(cpu.read_hl(), cpu.cy());
     }
   };
 
@@ -677,7 +630,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.a_, cpu.cy_);
+      cpu.adda(cpu.a_, cpu.cy());
     }
   };
 
@@ -687,7 +640,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.b_, 0);
+      cpu.suba(cpu.b(), 0);
     }
   };
 
@@ -697,7 +650,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.c_, 0);
+      cpu.suba(cpu.c(), 0);
     }
   };
 
@@ -707,7 +660,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.d_, 0);
+      cpu.suba(cpu.d(), 0);
     }
   };
 
@@ -717,7 +670,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.e_, 0);
+      cpu.suba(cpu.e(), 0);
     }
   };
 
@@ -727,7 +680,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.h_, 0);
+      cpu.suba(cpu.h(), 0);
     }
   };
 
@@ -737,7 +690,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.l_, 0);
+      cpu.suba(cpu.l(), 0);
     }
   };
 
@@ -745,7 +698,7 @@ private:
   {
     static constexpr auto name = "sub_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.suba(cpu.read_hl(), 0);
     }
@@ -767,7 +720,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.b_, cpu.cy_);
+      cpu.suba(cpu.b(), cpu.cy());
     }
   };
 
@@ -777,7 +730,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.c_, cpu.cy_);
+      cpu.suba(cpu.c(), cpu.cy());
     }
   };
 
@@ -787,7 +740,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.d_, cpu.cy_);
+      cpu.suba(cpu.d(), cpu.cy());
     }
   };
 
@@ -797,7 +750,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.e_, cpu.cy_);
+      cpu.suba(cpu.e(), cpu.cy());
     }
   };
 
@@ -807,7 +760,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.h_, cpu.cy_);
+      cpu.suba(cpu.h(), cpu.cy());
     }
   };
 
@@ -817,7 +770,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.l_, cpu.cy_);
+      cpu.suba(cpu.l(), cpu.cy());
     }
   };
 
@@ -825,9 +778,9 @@ private:
   {
     static constexpr auto name = "sbb_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.suba(cpu.read_hl(), cpu.cy_);
+      cpu.suba(cpu.read_hl(), cpu.cy());
     }
   };
 
@@ -837,22 +790,22 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.a_, cpu.cy_);
+      cpu.suba(cpu.a_, cpu.cy());
     }
   };
 
-  struct ana_b : i_ana<0xa0, &cpu::b_> {static constexpr auto name = "ana_b";};
-  struct ana_c : i_ana<0xa1, &cpu::c_> {static constexpr auto name = "ana_c";};
-  struct ana_d : i_ana<0xa2, &cpu::d_> {static constexpr auto name = "ana_d";};
-  struct ana_e : i_ana<0xa3, &cpu::e_> {static constexpr auto name = "ana_e";};
-  struct ana_h : i_ana<0xa4, &cpu::h_> {static constexpr auto name = "ana_h";};
-  struct ana_l : i_ana<0xa5, &cpu::l_> {static constexpr auto name = "ana_l";};
+  struct ana_b : i_ana<0xa0, reg::b> {static constexpr auto name = "ana_b";};
+  struct ana_c : i_ana<0xa1, reg::c> {static constexpr auto name = "ana_c";};
+  struct ana_d : i_ana<0xa2, reg::d> {static constexpr auto name = "ana_d";};
+  struct ana_e : i_ana<0xa3, reg::e> {static constexpr auto name = "ana_e";};
+  struct ana_h : i_ana<0xa4, reg::h> {static constexpr auto name = "ana_h";};
+  struct ana_l : i_ana<0xa5, reg::l> {static constexpr auto name = "ana_l";};
   struct ana_m : meta::describe_instruction<0xa6, 7, 1>
   {
     static constexpr auto name = "ana_m";
-    void operator()(cpu& cpu) const {cpu.ana(cpu.read_hl());}
+    void operator()(cpu& cpu) const noexcept(memory_noexcept) {cpu.ana(cpu.read_hl());}
   };
-  struct ana_a : i_ana<0xa7, &cpu::a_> {static constexpr auto name = "ana_a";};
+  struct ana_a : i_ana<0xa7, reg::a> {static constexpr auto name = "ana_a";};
 
   struct xra_b : meta::describe_instruction<0xa8, 4, 1>
   {
@@ -860,7 +813,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.b_);
+      cpu.xra(cpu.b());
     }
   };
 
@@ -870,7 +823,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.c_);
+      cpu.xra(cpu.c());
     }
   };
 
@@ -880,7 +833,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.d_);
+      cpu.xra(cpu.d());
     }
   };
 
@@ -890,7 +843,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.e_);
+      cpu.xra(cpu.e());
     }
   };
 
@@ -900,7 +853,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.h_);
+      cpu.xra(cpu.h());
     }
   };
 
@@ -910,7 +863,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.xra(cpu.l_);
+      cpu.xra(cpu.l());
     }
   };
 
@@ -918,7 +871,7 @@ private:
   {
     static constexpr auto name = "xra_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.xra(cpu.read_hl());
     }
@@ -940,7 +893,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.b_);
+      cpu.ora(cpu.b());
     }
   };
 
@@ -950,7 +903,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.c_);
+      cpu.ora(cpu.c());
     }
   };
 
@@ -960,7 +913,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.d_);
+      cpu.ora(cpu.d());
     }
   };
 
@@ -970,7 +923,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.e_);
+      cpu.ora(cpu.e());
     }
   };
 
@@ -980,7 +933,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.h_);
+      cpu.ora(cpu.h());
     }
   };
 
@@ -990,7 +943,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.ora(cpu.l_);
+      cpu.ora(cpu.l());
     }
   };
 
@@ -998,7 +951,7 @@ private:
   {
     static constexpr auto name = "ora_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.ora(cpu.read_hl());
     }
@@ -1020,7 +973,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.b_);
+      cpu.cmp(cpu.b());
     }
   };
 
@@ -1030,7 +983,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.c_);
+      cpu.cmp(cpu.c());
     }
   };
 
@@ -1040,7 +993,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.d_);
+      cpu.cmp(cpu.d());
     }
   };
 
@@ -1050,7 +1003,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.e_);
+      cpu.cmp(cpu.e());
     }
   };
 
@@ -1060,7 +1013,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.h_);
+      cpu.cmp(cpu.h());
     }
   };
 
@@ -1070,7 +1023,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.cmp(cpu.l_);
+      cpu.cmp(cpu.l());
     }
   };
 
@@ -1078,7 +1031,7 @@ private:
   {
     static constexpr auto name = "cmp_m";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.cmp(cpu.read_hl());
     }
@@ -1098,9 +1051,9 @@ private:
   {
     static constexpr auto name = "rnz";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(not cpu.z_);
+      return cpu.conditional_ret(not cpu.z());
     }
   };
 
@@ -1108,9 +1061,9 @@ private:
   {
     static constexpr auto name = "pop_b";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      std::tie(cpu.b_, cpu.c_) = cpu.pop();
+      cpu.bc_ = cpu.pop_word();
     }
   };
 
@@ -1120,7 +1073,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), not cpu.z_);
+      cpu.conditional_jump(cpu.operands_word(), not cpu.z());
     }
   };
 
@@ -1138,9 +1091,9 @@ private:
   {
     static constexpr auto name = "cnz";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), not cpu.z_);
+      return cpu.conditional_call(cpu.operands_word(), not cpu.z());
     }
   };
 
@@ -1148,9 +1101,9 @@ private:
   {
     static constexpr auto name = "push_b";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.push(cpu.b_, cpu.c_);
+      cpu.push_word(cpu.bc_);
     }
   };
 
@@ -1168,7 +1121,7 @@ private:
   {
     static constexpr auto name = "rst_0";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0000);
     }
@@ -1178,9 +1131,9 @@ private:
   {
     static constexpr auto name = "rz";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(cpu.z_);
+      return cpu.conditional_ret(cpu.z());
     }
   };
 
@@ -1188,7 +1141,7 @@ private:
   {
     static constexpr auto name = "ret";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.ret();
     }
@@ -1198,9 +1151,9 @@ private:
   {
     static constexpr auto name = "jz";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), cpu.z_);
+      cpu.conditional_jump(cpu.operands_word(), cpu.z());
     }
   };
 
@@ -1208,9 +1161,9 @@ private:
   {
     static constexpr auto name = "cz";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), cpu.z_);
+      return cpu.conditional_call(cpu.operands_word(), cpu.z());
     }
   };
 
@@ -1218,7 +1171,7 @@ private:
   {
     static constexpr auto name = "call";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       return cpu.call(cpu.operands_word());
     }
@@ -1230,7 +1183,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.adda(cpu.op1(), cpu.cy_);
+      cpu.adda(cpu.op1(), cpu.cy());
     }
   };
 
@@ -1238,7 +1191,7 @@ private:
   {
     static constexpr auto name = "rst_1";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0008);
     }
@@ -1248,9 +1201,9 @@ private:
   {
     static constexpr auto name = "rnc";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(not cpu.cy_);
+      return cpu.conditional_ret(not cpu.cy());
     }
   };
 
@@ -1258,9 +1211,9 @@ private:
   {
     static constexpr auto name = "pop_d";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      std::tie(cpu.d_, cpu.e_) = cpu.pop();
+      cpu.de_ = cpu.pop_word();
     }
   };
 
@@ -1268,9 +1221,9 @@ private:
   {
     static constexpr auto name = "jnc";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), not cpu.cy_);
+      cpu.conditional_jump(cpu.operands_word(), not cpu.cy());
     }
   };
 
@@ -1278,17 +1231,22 @@ private:
   {
     static constexpr auto name = "out";
 
-    void operator()(cpu& cpu) const noexcept
-    {}
+    void operator()(cpu& cpu) const noexcept(not has_io_bus)
+    {
+      if constexpr (has_io_bus)
+      {
+        cpu.machine().io_bus().out(cpu.op1(), cpu.a());
+      }
+    }
   };
 
   struct cnc : meta::describe_instruction<0xd4, 11, 3, meta::constant_instruction<false, 6>>
   {
     static constexpr auto name = "cnc";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), not cpu.cy_);
+      return cpu.conditional_call(cpu.operands_word(), not cpu.cy());
     }
   };
 
@@ -1296,9 +1254,9 @@ private:
   {
     static constexpr auto name = "push_d";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.push(cpu.d_, cpu.e_);
+      cpu.push_word(cpu.de_);
     }
   };
 
@@ -1316,7 +1274,7 @@ private:
   {
     static constexpr auto name = "rst_2";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0010);
     }
@@ -1326,9 +1284,9 @@ private:
   {
     static constexpr auto name = "rc";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(cpu.cy_);
+      return cpu.conditional_ret(cpu.cy());
     }
   };
 
@@ -1336,9 +1294,9 @@ private:
   {
     static constexpr auto name = "jc";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), cpu.cy_);
+      cpu.conditional_jump(cpu.operands_word(), cpu.cy());
     }
   };
 
@@ -1346,17 +1304,22 @@ private:
   {
     static constexpr auto name = "in";
 
-    void operator()(cpu& cpu) const noexcept
-    {}
+    void operator()(cpu& cpu) const noexcept(not has_io_bus)
+    {
+      if constexpr (has_io_bus)
+      {
+        cpu.a() = cpu.machine().io_bus().in(cpu.op1());
+      }
+    }
   };
 
   struct cc : meta::describe_instruction<0xdc, 11, 3, meta::constant_instruction<false, 6>>
   {
     static constexpr auto name = "cc";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), cpu.cy_ != 0);
+      return cpu.conditional_call(cpu.operands_word(), cpu.cy() != 0);
     }
   };
 
@@ -1366,7 +1329,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.suba(cpu.op1(), cpu.cy_);
+      cpu.suba(cpu.op1(), cpu.cy());
     }
   };
 
@@ -1374,7 +1337,7 @@ private:
   {
     static constexpr auto name = "rst_3";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0018);
     }
@@ -1384,9 +1347,9 @@ private:
   {
     static constexpr auto name = "rpo";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(not cpu.p_);
+      return cpu.conditional_ret(not cpu.p());
     }
   };
 
@@ -1394,9 +1357,9 @@ private:
   {
     static constexpr auto name = "pop_h";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      std::tie(cpu.h_, cpu.l_) = cpu.pop();
+      cpu.hl_ = cpu.pop_word();
     }
   };
 
@@ -1406,7 +1369,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), not cpu.p_);
+      cpu.conditional_jump(cpu.operands_word(), not cpu.p());
     }
   };
 
@@ -1414,14 +1377,11 @@ private:
   {
     static constexpr auto name = "xthl";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      const auto h = cpu.h_;
-      const auto l = cpu.l_;
-      cpu.l_= cpu.memory_read_byte(cpu.sp_);
-      cpu.h_= cpu.memory_read_byte(cpu.sp_ + 1);
-      cpu.memory_write_byte(cpu.sp_, l);
-      cpu.memory_write_byte(cpu.sp_ + 1, h);
+      const auto hl = cpu.hl_;
+      cpu.hl_ = cpu.memory_read_word(cpu.sp_);
+      cpu.memory_write_word(cpu.sp_, hl);
     }
   };
 
@@ -1429,9 +1389,9 @@ private:
   {
     static constexpr auto name = "cpo";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), not cpu.p_);
+      return cpu.conditional_call(cpu.operands_word(), not cpu.p());
     }
   };
 
@@ -1439,9 +1399,9 @@ private:
   {
     static constexpr auto name = "push_h";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      cpu.push(cpu.h_, cpu.l_);
+      cpu.push_word(cpu.hl_);
     }
   };
 
@@ -1459,7 +1419,7 @@ private:
   {
     static constexpr auto name = "rst_4";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0020);
     }
@@ -1469,9 +1429,9 @@ private:
   {
     static constexpr auto name = "rpe";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(cpu.p_);
+      return cpu.conditional_ret(cpu.p());
     }
   };
 
@@ -1491,7 +1451,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), cpu.p_);
+      cpu.conditional_jump(cpu.operands_word(), cpu.p());
     }
   };
 
@@ -1501,8 +1461,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      std::swap(cpu.d_, cpu.h_);
-      std::swap(cpu.e_, cpu.l_);
+      std::swap(cpu.de_, cpu.hl_);
     }
   };
 
@@ -1510,9 +1469,9 @@ private:
   {
     static constexpr auto name = "cpe";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), cpu.p_ != 0);
+      return cpu.conditional_call(cpu.operands_word(), cpu.p() != 0);
     }
   };
 
@@ -1530,7 +1489,7 @@ private:
   {
     static constexpr auto name = "rst_5";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0028);
     }
@@ -1540,9 +1499,9 @@ private:
   {
     static constexpr auto name = "rp";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(not cpu.s_);
+      return cpu.conditional_ret(not cpu.s());
     }
   };
 
@@ -1550,16 +1509,11 @@ private:
   {
     static constexpr auto name = "pop_psw";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       auto flags = std::uint8_t{};
       std::tie(cpu.a_, flags) = cpu.pop();
-
-      cpu.s_  = flags & 0b10000000 ? true : false;
-      cpu.z_  = flags & 0b01000000 ? true : false;
-      cpu.ac_ = flags & 0b00010000 ? true : false;
-      cpu.p_  = flags & 0b00000100 ? true : false;
-      cpu.cy_ = flags & 0b00000001 ? true : false;
+      cpu.set_psw((flags & (sign | zero | aux_carry | parity | carry)) | psw_bit_1);
     }
   };
 
@@ -1569,7 +1523,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), not cpu.s_);
+      cpu.conditional_jump(cpu.operands_word(), not cpu.s());
     }
   };
 
@@ -1587,9 +1541,9 @@ private:
   {
     static constexpr auto name = "cp";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), not cpu.s_);
+      return cpu.conditional_call(cpu.operands_word(), not cpu.s());
     }
   };
 
@@ -1597,21 +1551,9 @@ private:
   {
     static constexpr auto name = "push_psw";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      auto flags = std::uint8_t{0};
-
-      if (cpu.s_)  flags |= 0b10000000;
-      if (cpu.z_)  flags |= 0b01000000;
-      if (cpu.ac_) flags |= 0b00010000;
-      if (cpu.p_)  flags |= 0b00000100;
-      if (cpu.cy_) flags |= 0b00000001;
-
-      flags |=  0b00000010; // bit 1 is always 1
-      flags &= ~0b00001000; // bit 3 is always 0
-      flags &= ~0b00100000; // bit 5 is always 0
-
-      cpu.push(cpu.a_, flags);
+      cpu.push(cpu.a_, cpu.psw());
     }
   };
 
@@ -1629,7 +1571,7 @@ private:
   {
     static constexpr auto name = "rst_6";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0030);
     }
@@ -1640,9 +1582,9 @@ private:
   {
     static constexpr auto name = "rm";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_ret(cpu.s_);
+      return cpu.conditional_ret(cpu.s());
     }
   };
 
@@ -1662,7 +1604,7 @@ private:
 
     void operator()(cpu& cpu) const noexcept
     {
-      cpu.conditional_jump(cpu.operands_word(), cpu.s_);
+      cpu.conditional_jump(cpu.operands_word(), cpu.s());
     }
   };
 
@@ -1670,9 +1612,13 @@ private:
   {
     static constexpr auto name = "ei";
 
+    // Interrupts are enabled after the next instruction, even for requests raised in between: end
+    // the current run chunk so that run() executes this instruction on its own before accepting any.
     void operator()(cpu& cpu) const noexcept
     {
       cpu.enable_interrupt();
+      cpu.interrupt_delay_ = true;
+      cpu.limit_ = 0;
     }
   };
 
@@ -1680,9 +1626,9 @@ private:
   {
     static constexpr auto name = "cm";
 
-    auto operator()(cpu& cpu) const
+    auto operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
-      return cpu.conditional_call(cpu.operands_word(), cpu.s_ != 0);
+      return cpu.conditional_call(cpu.operands_word(), cpu.s() != 0);
     }
   };
 
@@ -1700,7 +1646,7 @@ private:
   {
     static constexpr auto name = "rst_7";
 
-    void operator()(cpu& cpu) const
+    void operator()(cpu& cpu) const noexcept(memory_noexcept)
     {
       cpu.call(0x0038);
     }
@@ -1972,27 +1918,200 @@ private:
     typename Machine::overrides
   >;
 
+  // Bits of the flags in the PSW. Bit 1 is always set, bits 3 and 5 are always cleared.
+  static constexpr auto carry     = std::uint8_t{0b00000001};
+  static constexpr auto psw_bit_1 = std::uint8_t{0b00000010};
+  static constexpr auto parity    = std::uint8_t{0b00000100};
+  static constexpr auto aux_carry = std::uint8_t{0b00010000};
+  static constexpr auto zero      = std::uint8_t{0b01000000};
+  static constexpr auto sign      = std::uint8_t{0b10000000};
+
+  // The sign, zero and parity flags resulting from each value, along with bit 1.
+  static constexpr auto szp = []
+  {
+    auto table = std::array<std::uint8_t, 256>{};
+    for (auto i = 0; i < 256; ++i)
+    {
+      const auto value = static_cast<std::uint8_t>(i);
+      table[i] = (value & sign)
+               | (value == 0 ? zero : 0)
+               | (util::parity(value) ? parity : 0)
+               | psw_bit_1;
+    }
+    return table;
+  }();
+
+  // The carry and auxiliary carry of the 9-bit result res of a + value + carry.
+  [[nodiscard]]
+  static constexpr
+  std::uint8_t
+  sum_carries(std::uint8_t a, std::uint8_t value, std::uint16_t res)
+  noexcept
+  {
+    return ((res >> 8) & carry) | ((a ^ res ^ value) & aux_carry);
+  }
+
+  // The carry and auxiliary carry of the 9-bit result res of a - value - carry.
+  [[nodiscard]]
+  static constexpr
+  std::uint8_t
+  difference_carries(std::uint8_t a, std::uint8_t value, std::uint16_t res)
+  noexcept
+  {
+    return ((res >> 8) & carry) | (~(a ^ res ^ value) & aux_carry);
+  }
+
+  // A + value + carry, along with the resulting flags, packed as (flags << 8) | result.
+  [[nodiscard]]
+  static constexpr
+  std::uint16_t
+  sum(std::uint8_t a, std::uint8_t value, bool carry_in)
+  noexcept
+  {
+    const std::uint16_t res = a + value + carry_in;
+    const std::uint8_t flags = szp[res & 0xff] | sum_carries(a, value, res);
+    return flags << 8 | (res & 0xff);
+  }
+
+  // A - value - carry, along with the resulting flags, packed as (flags << 8) | result.
+  [[nodiscard]]
+  static constexpr
+  std::uint16_t
+  difference(std::uint8_t a, std::uint8_t value, bool carry_in)
+  noexcept
+  {
+    const std::uint16_t res = a - value - carry_in;
+    const std::uint8_t flags = szp[res & 0xff] | difference_carries(a, value, res);
+    return flags << 8 | (res & 0xff);
+  }
+
+  // The decimal adjustment of A, along with the resulting flags, packed as (flags << 8) | result.
+  [[nodiscard]]
+  static constexpr
+  std::uint16_t
+  decimal_adjust(std::uint8_t a, bool ac, bool cy)
+  noexcept
+  {
+    const std::uint8_t lsb = a & 0x0f;
+    const std::uint8_t msb = a >> 4;
+
+    auto value_to_add = std::uint8_t{0};
+    if (ac or lsb > 9)
+    {
+      value_to_add += 0x06;
+    }
+    if (cy or msb > 9 or (msb >= 9 and lsb > 9))
+    {
+      value_to_add += 0x60;
+      cy = true;
+    }
+    return (sum(a, value_to_add, false) & ~(carry << 8)) | (cy << 8);
+  }
+
+  // The results of sum, difference and decimal_adjust for all their arguments, indexed by
+  // carry << 16 | a << 8 | value and by ac << 9 | cy << 8 | a. They are only instantiated when the
+  // machine enables them, and are evaluated at compile time into read-only data.
+  struct alu_tables
+  {
+    static constexpr auto sums = tabulate<0x20000>([](std::size_t i)
+    {
+      return cpu::sum(i >> 8, i, i >> 16);
+    });
+
+    static constexpr auto differences = tabulate<0x20000>([](std::size_t i)
+    {
+      return cpu::difference(i >> 8, i, i >> 16);
+    });
+
+    static constexpr auto decimal_adjustments = tabulate<0x400>([](std::size_t i)
+    {
+      return cpu::decimal_adjust(i, i >> 9, (i >> 8) & 1);
+    });
+  };
+
+  // Maximal number of cycles executed by a single chain of threaded handlers.
+  static constexpr auto max_threaded_cycles = std::uint64_t{4096};
+
+  // Maximal number of instructions in a decoded block.
+  static constexpr auto max_block_instructions = std::size_t{32};
+
+  // Maximal number of decoded instructions in a trace, guards included. A looping trace goes
+  // back to its start by a distance stored in the 8-bit opcode field.
+  static constexpr auto max_trace_instructions = std::size_t{255};
+
+  using decoded_type = meta::decoded_instruction<cpu>;
+  using decoded_handlers = typename meta::decoded_handlers<cpu, instructions>::type;
+
+  // Sequences of instructions decoded to a single handler, the most frequent ones in Space Invaders
+  // and in the CPU test ROMs.
+  using fusions = meta::fusions<cpu, decoded_handlers, meta::sequences<
+    meta::sequence<0x3a, 0xa7, 0xc2>, // lda; ana a; jnz
+    meta::sequence<0x3a, 0xa7, 0xca>, // lda; ana a; jz
+    meta::sequence<0x3a, 0x3d, 0xc2>, // lda; dcr a; jnz
+    meta::sequence<0x7e, 0xa7, 0xc2>, // mov a, m; ana a; jnz
+    meta::sequence<0x7e, 0xa7, 0xca>, // mov a, m; ana a; jz
+    meta::sequence<0x23, 0x05, 0xc2>, // inx h; dcr b; jnz
+    meta::sequence<0x23, 0x0d, 0xc2>, // inx h; dcr c; jnz
+    meta::sequence<0x1a, 0x77, 0x23>, // ldax d; mov m, a; inx h
+    meta::sequence<0x05, 0xc2>,       // dcr b; jnz
+    meta::sequence<0x0d, 0xc2>,       // dcr c; jnz
+    meta::sequence<0xfe, 0xc2>,       // cpi; jnz
+    meta::sequence<0xfe, 0xca>,       // cpi; jz
+    meta::sequence<0xfe, 0xda>,       // cpi; jc
+    meta::sequence<0x77, 0x23>,       // mov m, a; inx h
+    meta::sequence<0x7e, 0x23>,       // mov a, m; inx h
+    meta::sequence<0x13, 0x23>,       // inx d; inx h
+    meta::sequence<0x23, 0x13>,       // inx h; inx d
+    meta::sequence<0x21, 0x7e>        // lxi h; mov a, m
+  >>;
+
+  static constexpr bool has_memory_words = specific::has_memory_words<Machine>::value;
+
+  static constexpr bool has_readable_memory = specific::has_readable_memory<Machine>::value;
+
+  // The in and out instructions go through the I/O bus of the machine, whose handlers may throw.
+  static constexpr bool has_io_bus = specific::has_io_bus<Machine>::value;
+
+  // Instructions never throw, unless the memory of the machine does.
+  static constexpr bool memory_noexcept = specific::memory_noexcept<Machine>::value;
+
+  // Opcodes whose instruction is provided by the machine.
+  static constexpr auto overridden = meta::opcodes(typename Machine::overrides{});
+
+  static constexpr auto has_alu_tables = alu_tables_enabled<Machine>::value;
+
+  static constexpr auto has_lazy_flags = lazy_flags_enabled<Machine>::value;
+
 public:
 
   cpu(Machine& machine)
     : a_{0}
-    , b_{0}
-    , c_{0}
-    , d_{0}
-    , e_{0}
-    , h_{0}
-    , l_{0}
+    , bc_{0}
+    , de_{0}
+    , hl_{0}
     , sp_{0}
-    , cy_{0}
-    , p_{0}
-    , ac_{0}
-    , z_{0}
-    , s_{0}
+    , psw_{psw_bit_1}
+    , result_{0}
+    , lazy_{false}
     , machine_{machine}
     , interrupt_{false}
+    , interrupt_delay_{false}
+    , pending_{0}
+    , halted_{false}
     , cycles_{0}
     , pc_{}
-  {}
+    , limit_{0}
+    , stop_{stop_reason::budget}
+    , operands_{0}
+    , unreadable_read_{false}
+    , blocks_{}
+    , compiled_{}
+    , profile_{}
+    , dirty_pages_{}
+  {
+    // The first checkpoint holds the whole memory.
+    dirty_pages_.set();
+  }
 
   friend
   std::ostream&
@@ -2001,160 +2120,529 @@ public:
     return os
       << std::resetiosflags(std::ios_base::basefield)
       << " "
-      << (cpu.z_ ? "z" : ".")
-      << (cpu.s_ ? "s" : ".")
-      << (cpu.p_ ? "p" : ".")
-      << (cpu.cy_ ? "c" : ".")
-      << (cpu.ac_ ? "a" : ".")
+      << (cpu.z() ? "z" : ".")
+      << (cpu.s() ? "s" : ".")
+      << (cpu.p() ? "p" : ".")
+      << (cpu.cy() ? "c" : ".")
+      << (cpu.ac() ? "a" : ".")
       << std::hex
-      << "  A $" << std::setfill('0') << std::setw(2) << +cpu.a__
-      << " B $"  << std::setfill('0') << std::setw(2) << +cpu.b__
-      << " C $"  << std::setfill('0') << std::setw(2) << +cpu.c_
-      << " D $"  << std::setfill('0') << std::setw(2) << +cpu.d_
-      << " E $"  << std::setfill('0') << std::setw(2) << +cpu.e_
-      << " H $"  << std::setfill('0') << std::setw(2) << +cpu.h_
-      << " L $"  << std::setfill('0') << std::setw(2) << +cpu.l_
+      << "  A $" << std::setfill('0') << std::setw(2) << +cpu.a_
+      << " B $"  << std::setfill('0') << std::setw(2) << +cpu.b()
+      << " C $"  << std::setfill('0') << std::setw(2) << +cpu.c()
+      << " D $"  << std::setfill('0') << std::setw(2) << +cpu.d()
+      << " E $"  << std::setfill('0') << std::setw(2) << +cpu.e()
+      << " H $"  << std::setfill('0') << std::setw(2) << +cpu.h()
+      << " L $"  << std::setfill('0') << std::setw(2) << +cpu.l()
       << " SP "  << std::setfill('0') << std::setw(4) << +cpu.sp_
       ;
   }
 
-  std::uint64_t
+  run_result
   step()
   {
     return step(util::dummy{});
   }
 
+  // Execute a single instruction. Its reason is budget unless the instruction has stopped the cpu.
+  // Accepting a pending interrupt counts as a step of its own.
+  // While waiting for an interrupt after hlt, let the time of a nop pass instead.
   template <typename Fn>
-  std::uint64_t
+  run_result
   step(Fn&& fn)
   {
-    const auto opcode = memory_read_byte(pc_);
-    pc_ += 1;
+    stop_ = stop_reason::budget;
+    if (interrupt_delay_)
+    {
+      interrupt_delay_ = false;
+    }
+    else if (const auto cycles = accept_interrupt(); cycles != 0)
+    {
+      increment_cycles(cycles);
+      return {cycles, stop_};
+    }
+    if (halted_)
+    {
+      increment_cycles(decoded_handlers::cycles[0x00]);
+      return {decoded_handlers::cycles[0x00], stop_};
+    }
+    const auto opcode = fetch();
     const auto cycles = meta::step(instructions{}, opcode, *this, std::forward<Fn>(fn));
     increment_cycles(cycles);
-    return cycles;
+    return {cycles, stop_};
+  }
+
+  run_result
+  run(std::uint64_t budget)
+  {
+    return run(budget, util::dummy{});
+  }
+
+  // Execute instructions using threaded dispatch until at least budget cycles have been consumed
+  // or until an instruction calls stop(), hlt and unimplemented opcodes included.
+  // Pending interrupts are accepted when run() starts, between the chunks it executes, which end
+  // early when an interrupt is raised, and after the instruction which follows ei.
+  // After hlt with interrupts enabled, the whole budget is consumed at once until an interrupt.
+  // Without hooks, instructions are executed from decoded blocks rather than from memory.
+  template <typename Fn>
+  run_result
+  run(std::uint64_t budget, Fn&& fn)
+  {
+    stop_ = stop_reason::budget;
+    auto cycles = std::uint64_t{0};
+    while (cycles < budget and stop_ == stop_reason::budget)
+    {
+      if (interrupt_delay_)
+      {
+        interrupt_delay_ = false;
+        if (not halted_)
+        {
+          cycles += meta::step(instructions{}, fetch(), *this, fn);
+          continue;
+        }
+      }
+      if (const auto accepted = accept_interrupt(); accepted != 0)
+      {
+        cycles += accepted;
+        continue;
+      }
+      if (halted_)
+      {
+        cycles = budget;
+        break;
+      }
+      limit_ = std::min(budget - cycles, max_threaded_cycles);
+      if constexpr (std::is_same_v<std::decay_t<Fn>, util::dummy>)
+      {
+        blocks_.collect();
+        cycles += meta::run_decoded(*this, limit_);
+      }
+      else
+      {
+        cycles += meta::run(instructions{}, *this, fn, limit_);
+      }
+    }
+    increment_cycles(cycles);
+    return {cycles, stop_};
   }
 
+  // Make the current run() return after the executing instruction, with reason.
   void
-  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  stop(stop_reason reason = stop_reason::requested)
+  noexcept
   {
-    machine_.memory_write_byte(address, value);
+    stop_ = reason;
+    limit_ = 0;
   }
 
   [[nodiscard]]
   std::uint8_t
-  memory_read_byte(std::uint16_t address)
-  const
+  fetch()
   {
-    return machine_.memory_read_byte(address);
+    const auto opcode = memory_read_byte(pc_);
+    pc_ += 1;
+    return opcode;
   }
 
+  // Read the operands of the current instruction.
+  template <std::uint8_t Bytes>
   void
-  write_hl(std::uint8_t value)
+  fetch_operands()
   {
-    memory_write_byte(hl(), value);
+    if constexpr (Bytes == 2)
+    {
+      operands_ = memory_read_byte(pc_);
+      pc_ += 1;
+    }
+    else if constexpr (Bytes == 3)
+    {
+      operands_ = memory_read_word(pc_);
+      pc_ += 2;
+    }
   }
 
-  [[nodiscard]]
-  std::uint8_t
-  read_hl()
-  const
+  // Set the operands of a decoded instruction and move PC past it.
+  template <std::uint8_t Bytes>
+  void
+  load_operands(std::uint16_t operands)
+  noexcept
   {
-    const auto offset = hl();
-    return memory_read_byte(offset);
+    operands_ = operands;
+    pc_ += Bytes;
   }
 
+  // Get the decoded block starting at the current PC, decoding it if needed.
+  // A hot block is replaced by a trace.
   [[nodiscard]]
-  std::uint16_t
-  hl()
-  const noexcept
+  const decoded_type*
+  decoded_block()
   {
-    return (h_ << 8) | l_;
+    if (const auto block = blocks_.find(pc_); block)
+    {
+      // Compiled blocks are excluded from profiling.
+      if (profile_.hot(pc_))
+      {
+        if (const auto trace = record_trace(pc_); trace)
+        {
+          return trace;
+        }
+      }
+      return block;
+    }
+    return decode_block(pc_);
   }
 
+  // Same as decoded_block(), once the block of code starting at previous has been executed.
   [[nodiscard]]
-  std::uint16_t
-  bc()
-  const noexcept
+  const decoded_type*
+  decoded_block(std::uint16_t previous)
   {
-    return (b_ << 8) | c_;
+    profile_.follow(previous, pc_);
+    return decoded_block();
   }
 
+  // Add to cycles the iterations of the idle loop made of the decoded instructions from first to
+  // last, excluded, which would complete before limit is reached.
+  // Only reads of readable memory are known to have no effect: when the previous iteration has read
+  // memory outside of it, e.g. a status register behind a handler of a memory map, nothing is
+  // skipped, so that each iteration reads it again.
   [[nodiscard]]
-  std::uint16_t
-  de()
+  std::uint64_t
+  skip_idle_iterations(const decoded_type* first, const decoded_type* last, std::uint64_t cycles,
+                       std::uint64_t limit)
   const noexcept
   {
-    return (d_ << 8) | e_;
+    if (std::exchange(unreadable_read_, false))
+    {
+      return cycles;
+    }
+    auto iteration = std::uint64_t{0};
+    for (; first != last; ++first)
+    {
+      if (first->handler != &meta::guard<cpu>)
+      {
+        iteration += decoded_handlers::cycles[first->opcode];
+      }
+    }
+    if (cycles < limit)
+    {
+      cycles += (limit - 1 - cycles) / iteration * iteration;
+    }
+    return cycles;
   }
 
-  void
-  push(std::uint8_t high, std::uint8_t low)
+  // Execute a single instruction for code compiled ahead of time, which has already set PC to the
+  // address of the instruction.
+  template <std::uint8_t Opcode>
+  std::uint64_t
+  execute(std::uint16_t operands)
   {
-    memory_write_byte(sp_ - 1, high);
-    memory_write_byte(sp_ - 2, low);
-    sp_ -= 2;
+    using instruction = meta::nth_instruction<Opcode, instructions>;
+    load_operands<instruction::bytes>(operands);
+    return instruction{}(*this);
   }
 
-  [[nodiscard]]
-  std::tuple<std::uint8_t, std::uint8_t>
-  pop()
+  // Use blocks compiled ahead of time rather than decoding them, when memory holds their code.
+  void
+  use_compiled_blocks(std::vector<meta::compiled_block<cpu>> blocks)
   {
-    const auto low = memory_read_byte(sp_);
-    const auto high = memory_read_byte(sp_ + 1);
-    sp_ += 2;
-    return {high, low};
+    std::sort(begin(blocks), end(blocks), [](const auto& lhs, const auto& rhs)
+    {
+      return lhs.first < rhs.first;
+    });
+    compiled_ = std::move(blocks);
+    blocks_.clear();
   }
 
   [[nodiscard]]
-  std::uint16_t
-  pop_word()
+  static constexpr
+  std::uint8_t
+  instruction_bytes(std::uint8_t opcode)
+  noexcept
   {
-    const auto low = memory_read_byte(sp_);
-    const auto high = memory_read_byte(sp_ + 1);
-    sp_ += 2;
-    return low | (high << 8);
+    return decoded_handlers::bytes[opcode];
   }
 
-  void
-  call(std::uint16_t addr)
+  [[nodiscard]]
+  static constexpr
+  const char*
+  instruction_name(std::uint8_t opcode)
+  noexcept
   {
-    push((pc_ >> 8) & 0x00ff, pc_ & 0x00ff);
-    pc_ = addr;
+    return decoded_handlers::names[opcode];
   }
 
+  // Instructions after which execution may not continue with the next instruction in memory.
   [[nodiscard]]
+  static constexpr
   bool
-  conditional_call(std::uint16_t addr, bool condition)
+  ends_block(std::uint8_t opcode)
+  noexcept
   {
-    if (condition)
+    if (opcode < 0xc0)
     {
-      call(addr);
-      return true;
+      return opcode == 0x76; // hlt
     }
-    else
+    switch (opcode & 0x0f)
     {
-      return false;
+      case 0x00: case 0x02: case 0x04: case 0x07: // conditional ret, jump and call, rst
+      case 0x08: case 0x0a: case 0x0c: case 0x0f:
+      case 0x0d:                                  // call
+        return true;
+      case 0x03:
+        return opcode == 0xc3;                    // jmp
+      case 0x09:
+        return opcode != 0xf9;                    // ret, pchl
+      default:
+        return false;
     }
   }
 
+  // To be called when the machine modifies memory by other means than the cpu.
   void
-  jump(std::uint16_t addr)
+  invalidate(std::uint16_t address)
   {
-    pc_ = addr;
+    dirty_pages_.set(address >> 8);
+    if (blocks_.is_code(address))
+    {
+      profile_.write(address);
+      blocks_.invalidate(address);
+      limit_ = 0;
+    }
   }
 
+  // To be called when the machine shows other memory at addresses from first to last, both
+  // included, e.g. after a bank switch. Only the code decoded from these addresses is dropped.
   void
-  conditional_jump(std::uint16_t addr, bool condition)
+  remap(std::uint16_t first, std::uint16_t last)
   {
-    if (condition)
+    for (auto page = first >> 8; ; page = (page + 1) & 0xff)
     {
-      jump(addr);
+      dirty_pages_.set(page);
+      if (page == last >> 8)
+      {
+        break;
+      }
     }
+    blocks_.invalidate(first, last);
+    limit_ = 0;
   }
 
-  void
-  ret()
+  // Tell if a decoded block holds the instruction byte at address.
+  [[nodiscard]]
+  bool
+  decoded(std::uint16_t address)
+  const noexcept
+  {
+    return blocks_.is_code(address);
+  }
+
+  // Pages of 256 bytes written since the last call to clear_dirty_pages().
+  [[nodiscard]]
+  const std::bitset<256>&
+  dirty_pages()
+  const noexcept
+  {
+    return dirty_pages_;
+  }
+
+  void
+  clear_dirty_pages()
+  noexcept
+  {
+    dirty_pages_.reset();
+  }
+
+  // Clear the dirty pages holding addresses from first to last, both included, e.g. after their
+  // content has been restored from a checkpoint.
+  void
+  clear_dirty_pages(std::uint16_t first, std::uint16_t last)
+  noexcept
+  {
+    for (auto page = first >> 8; ; page = (page + 1) & 0xff)
+    {
+      dirty_pages_.reset(page);
+      if (page == last >> 8)
+      {
+        break;
+      }
+    }
+  }
+
+  void
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  noexcept(memory_noexcept)
+  {
+    machine_.memory_write_byte(address, value);
+    invalidate(address);
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  memory_read_byte(std::uint16_t address)
+  const noexcept(memory_noexcept)
+  {
+    if constexpr (has_readable_memory)
+    {
+      if (const auto region = machine_.readable_memory(); region.contains(address, 1))
+      {
+        return *region.at(address);
+      }
+      unreadable_read_ = true;
+    }
+    return machine_.memory_read_byte(address);
+  }
+
+  // Write value at address and its high byte at address + 1.
+  void
+  memory_write_word(std::uint16_t address, std::uint16_t value)
+  noexcept(memory_noexcept)
+  {
+    const auto high_address = static_cast<std::uint16_t>(address + 1);
+    if constexpr (has_memory_words)
+    {
+      machine_.memory_write_word(address, value);
+    }
+    else
+    {
+      machine_.memory_write_byte(address, value & 0xff);
+      machine_.memory_write_byte(high_address, value >> 8);
+    }
+    invalidate(address);
+    invalidate(high_address);
+  }
+
+  // Read the word whose low byte is at address, and high byte at address + 1.
+  [[nodiscard]]
+  std::uint16_t
+  memory_read_word(std::uint16_t address)
+  const noexcept(memory_noexcept)
+  {
+    if constexpr (has_readable_memory)
+    {
+      if (const auto region = machine_.readable_memory(); region.contains(address, 2))
+      {
+        return load_word(region.at(address));
+      }
+      unreadable_read_ = true;
+    }
+    if constexpr (has_memory_words)
+    {
+      return machine_.memory_read_word(address);
+    }
+    else
+    {
+      return memory_read_byte(address)
+           | (memory_read_byte(static_cast<std::uint16_t>(address + 1)) << 8);
+    }
+  }
+
+  void
+  write_hl(std::uint8_t value)
+  {
+    memory_write_byte(hl_, value);
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  read_hl()
+  const
+  {
+    return memory_read_byte(hl_);
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  hl()
+  const noexcept
+  {
+    return hl_;
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  bc()
+  const noexcept
+  {
+    return bc_;
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  de()
+  const noexcept
+  {
+    return de_;
+  }
+
+  void
+  push(std::uint8_t high, std::uint8_t low)
+  {
+    push_word((high << 8) | low);
+  }
+
+  void
+  push_word(std::uint16_t value)
+  {
+    sp_ -= 2;
+    memory_write_word(sp_, value);
+  }
+
+  [[nodiscard]]
+  std::tuple<std::uint8_t, std::uint8_t>
+  pop()
+  {
+    const auto value = pop_word();
+    return {value >> 8, value & 0xff};
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  pop_word()
+  {
+    const auto value = memory_read_word(sp_);
+    sp_ += 2;
+    return value;
+  }
+
+  void
+  call(std::uint16_t addr)
+  {
+    push_word(pc_);
+    pc_ = addr;
+  }
+
+  [[nodiscard]]
+  bool
+  conditional_call(std::uint16_t addr, bool condition)
+  {
+    if (condition)
+    {
+      call(addr);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  void
+  jump(std::uint16_t addr)
+  {
+    pc_ = addr;
+  }
+
+  void
+  conditional_jump(std::uint16_t addr, bool condition)
+  {
+    if (condition)
+    {
+      jump(addr);
+    }
+  }
+
+  void
+  ret()
   {
     pc_ = pop_word();
   }
@@ -2177,28 +2665,25 @@ public:
   [[nodiscard]]
   std::uint8_t
   op1()
+  const noexcept
   {
-    const auto op1 = memory_read_byte(pc_);
-    pc_ += 1;
-    return op1;
+    return operands_ & 0x00ff;
   }
 
   [[nodiscard]]
   std::tuple<std::uint8_t, std::uint8_t>
   operands()
+  const noexcept
   {
-    const auto op1 = memory_read_byte(pc_ + 0);
-    const auto op2 = memory_read_byte(pc_ + 1);
-    pc_ += 2;
-    return {op1, op2};
+    return {operands_ & 0x00ff, operands_ >> 8};
   }
 
   [[nodiscard]]
   std::uint16_t
   operands_word()
+  const noexcept
   {
-    const auto [op1, op2] = operands();
-    return op1 | (op2 << 8);
+    return operands_;
   }
 
   [[nodiscard]]
@@ -2233,12 +2718,28 @@ public:
     return a_;
   }
 
+  [[nodiscard]]
+  std::uint8_t
+  b()
+  const noexcept
+  {
+    return bc_ >> 8;
+  }
+
   [[nodiscard]]
   std::uint8_t
   c()
   const noexcept
   {
-    return c_;
+    return bc_ & 0xff;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  d()
+  const noexcept
+  {
+    return de_ >> 8;
   }
 
   [[nodiscard]]
@@ -2246,7 +2747,23 @@ public:
   e()
   const noexcept
   {
-    return e_;
+    return de_ & 0xff;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  h()
+  const noexcept
+  {
+    return hl_ >> 8;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  l()
+  const noexcept
+  {
+    return hl_ & 0xff;
   }
 
   [[nodiscard]]
@@ -2257,6 +2774,76 @@ public:
     return pc_;
   }
 
+  // The flags, laid out as pushed by push_psw.
+  [[nodiscard]]
+  std::uint8_t
+  psw()
+  const noexcept
+  {
+    if constexpr (has_lazy_flags)
+    {
+      return lazy_ ? psw_ | szp[result_] : psw_;
+    }
+    else
+    {
+      return psw_;
+    }
+  }
+
+  [[nodiscard]]
+  bool
+  z()
+  const noexcept
+  {
+    if constexpr (has_lazy_flags)
+    {
+      return lazy_ ? result_ == 0 : psw_ & zero;
+    }
+    else
+    {
+      return psw_ & zero;
+    }
+  }
+
+  [[nodiscard]]
+  bool
+  s()
+  const noexcept
+  {
+    if constexpr (has_lazy_flags)
+    {
+      return lazy_ ? result_ & sign : psw_ & sign;
+    }
+    else
+    {
+      return psw_ & sign;
+    }
+  }
+
+  [[nodiscard]]
+  bool
+  p()
+  const noexcept
+  {
+    return psw() & parity;
+  }
+
+  [[nodiscard]]
+  bool
+  cy()
+  const noexcept
+  {
+    return psw_ & carry;
+  }
+
+  [[nodiscard]]
+  bool
+  ac()
+  const noexcept
+  {
+    return psw_ & aux_carry;
+  }
+
   void
   enable_interrupt()
   noexcept
@@ -2279,17 +2866,46 @@ public:
     return interrupt_;
   }
 
+  // Tell if the cpu waits for an interrupt after hlt.
+  [[nodiscard]]
+  bool
+  halted()
+  const noexcept
+  {
+    return halted_;
+  }
+
+  // Latch a request for RST rst, from 0 to 7, until it's accepted. Requests are sampled when
+  // interrupts are enabled, at the boundaries of run() chunks rather than after each instruction;
+  // when raised during run(), e.g. by a port handler, the current chunk ends early.
   void
-  interrupt(std::uint16_t interrupt)
+  raise_interrupt(std::uint8_t rst)
+  noexcept
   {
-    if (interrupt_enabled())
+    pending_ |= 1 << rst;
+    if (interrupt_)
     {
-      call(interrupt);
-      disable_interrupt();
-      increment_cycles(11);
+      limit_ = 0;
     }
   }
 
+  // Withdraw a request for RST rst which has not been accepted yet.
+  void
+  lower_interrupt(std::uint8_t rst)
+  noexcept
+  {
+    pending_ &= ~(1 << rst);
+  }
+
+  // RST n is requested if bit n is set.
+  [[nodiscard]]
+  std::uint8_t
+  pending_interrupts()
+  const noexcept
+  {
+    return pending_;
+  }
+
   [[nodiscard]]
   std::uint64_t
   cycles()
@@ -2300,16 +2916,266 @@ public:
 
 private:
 
+  [[nodiscard]]
+  static constexpr std::uint16_t
+  with_high(std::uint16_t pair, std::uint8_t value)
+  noexcept
+  {
+    return static_cast<std::uint16_t>((pair & 0x00ff) | (value << 8));
+  }
+
+  [[nodiscard]]
+  static constexpr std::uint16_t
+  with_low(std::uint16_t pair, std::uint8_t value)
+  noexcept
+  {
+    return static_cast<std::uint16_t>((pair & 0xff00) | value);
+  }
+
+  template <reg R>
+  [[nodiscard]]
+  std::uint8_t
+  get()
+  const noexcept
+  {
+    switch (R)
+    {
+      case reg::a: return a_;
+      case reg::b: return b();
+      case reg::c: return c();
+      case reg::d: return d();
+      case reg::e: return e();
+      case reg::h: return h();
+      default:     return l();
+    }
+  }
+
+  template <reg R>
+  void
+  set(std::uint8_t value)
+  noexcept
+  {
+    switch (R)
+    {
+      case reg::a: a_ = value; break;
+      case reg::b: bc_ = with_high(bc_, value); break;
+      case reg::c: bc_ = with_low(bc_, value); break;
+      case reg::d: de_ = with_high(de_, value); break;
+      case reg::e: de_ = with_low(de_, value); break;
+      case reg::h: hl_ = with_high(hl_, value); break;
+      default:     hl_ = with_low(hl_, value); break;
+    }
+  }
+
+  // Execute the RST of the pending request with the lowest number, if interrupts are enabled.
+  // Return the number of cycles it took.
+  std::uint64_t
+  accept_interrupt()
+  {
+    if (not interrupt_ or pending_ == 0)
+    {
+      return 0;
+    }
+    auto rst = 0;
+    while (not (pending_ & (1 << rst)))
+    {
+      ++rst;
+    }
+    pending_ &= ~(1 << rst);
+    halted_ = false;
+    call(rst * 8);
+    disable_interrupt();
+    return 11;
+  }
+
+  // The block compiled ahead of time starting at first, if memory still holds its code.
+  [[nodiscard]]
+  const meta::compiled_block<cpu>*
+  find_compiled_block(std::uint16_t first)
+  const
+  {
+    const auto it = std::lower_bound(begin(compiled_), end(compiled_), first,
+                                     [](const auto& block, auto address)
+                                     {
+                                       return block.first < address;
+                                     });
+    if (it == end(compiled_) or it->first != first)
+    {
+      return nullptr;
+    }
+    for (auto i = std::size_t{0}; i <= static_cast<std::size_t>(it->last - first); ++i)
+    {
+      if (memory_read_byte(first + i) != it->code[i])
+      {
+        return nullptr;
+      }
+    }
+    return &*it;
+  }
+
+  // Append the instructions of the block of code starting at address to instructions.
+  // Return the address following the block and the opcode of its last instruction.
+  std::pair<std::uint16_t, std::uint8_t>
+  decode(std::uint16_t address, std::vector<decoded_type>& instructions)
+  {
+    const auto first = instructions.size();
+    for (auto count = std::size_t{1}; ; ++count)
+    {
+      const auto opcode = memory_read_byte(address);
+      const auto bytes = decoded_handlers::bytes[opcode];
+      auto operands = std::uint16_t{0};
+      if (bytes == 2)
+      {
+        operands = memory_read_byte(address + 1);
+      }
+      else if (bytes == 3)
+      {
+        operands = memory_read_word(address + 1);
+      }
+      instructions.push_back({decoded_handlers::table[opcode], operands, opcode});
+      address += bytes;
+
+      if (ends_block(opcode) or count == max_block_instructions)
+      {
+        fusions::fuse(instructions.data() + first, instructions.data() + instructions.size());
+        return {address, opcode};
+      }
+    }
+  }
+
+  const decoded_type*
+  decode_block(std::uint16_t first)
+  {
+    if (const auto compiled = find_compiled_block(first); compiled)
+    {
+      auto block = std::vector<decoded_type>{
+        {compiled->execute, 0, memory_read_byte(first)},
+        {&meta::exit_block<cpu>, first, 0}
+      };
+      profile_.exclude(first);
+      return blocks_.insert(first, compiled->last, std::move(block));
+    }
+
+    auto block = std::vector<decoded_type>{};
+    const auto [next, last_opcode] = decode(first, block);
+    block.push_back({&meta::exit_block<cpu>, first, 0});
+    profile_.reset(first);
+    return blocks_.insert(first, next - 1, std::move(block));
+  }
+
+  // Decode the blocks of code which have followed each other from start, up to the first one
+  // without a known successor, or which would be executed twice, and chain them with guards.
+  // Return nullptr if there is nothing to chain.
+  const decoded_type*
+  record_trace(std::uint16_t start)
+  {
+    auto trace = std::vector<decoded_type>{};
+    auto ranges = std::vector<typename block_cache<decoded_type>::range>{};
+    auto block = std::vector<decoded_type>{};
+    auto address = start;
+    auto loops = false;
+    while (true)
+    {
+      block.clear();
+      const auto [next, last_opcode] = decode(address, block);
+      const auto last = static_cast<std::uint16_t>(next - 1);
+      if (profile_.written(address, last))
+      {
+        // Self-modifying code would invalidate the trace over and over.
+        break;
+      }
+      if (not ranges.empty())
+      {
+        trace.push_back({&meta::guard<cpu>, address, 0});
+      }
+      trace.insert(trace.end(), block.begin(), block.end());
+      ranges.push_back({address, last});
+
+      const auto successor = profile_.successor(address);
+      if (not successor or last_opcode == 0x76) // hlt
+      {
+        break;
+      }
+      if (*successor == start)
+      {
+        auto opcodes = std::vector<std::uint8_t>{};
+        for (const auto& instruction : trace)
+        {
+          if (instruction.handler != &meta::guard<cpu>)
+          {
+            opcodes.push_back(instruction.opcode);
+          }
+        }
+        // Without readable memory, reads may have any effect.
+        const auto idle = has_readable_memory and is_idle_loop(opcodes.begin(), opcodes.end(), overridden);
+        trace.push_back({idle ? &meta::idle_loop<cpu> : &meta::loop_trace<cpu>, start,
+                         static_cast<std::uint8_t>(trace.size())});
+        loops = true;
+        break;
+      }
+      const auto visited = std::any_of(ranges.begin(), ranges.end(),
+                                       [&](const auto& r){return r.first == *successor;});
+      if (visited
+          or trace.size() + max_block_instructions + 2 > max_trace_instructions
+          or find_compiled_block(*successor))
+      {
+        break;
+      }
+      address = *successor;
+    }
+
+    if (ranges.empty() or (ranges.size() == 1 and not loops))
+    {
+      return nullptr;
+    }
+    trace.push_back({&meta::exit_block<cpu>, ranges.back().first, 0});
+    return blocks_.insert(start, std::move(ranges), std::move(trace));
+  }
+
+  void
+  set_carry(bool value)
+  noexcept
+  {
+    psw_ = (psw_ & ~carry) | value;
+  }
+
+  // Set all the flags.
+  void
+  set_psw(std::uint8_t flags)
+  noexcept
+  {
+    psw_ = flags;
+    if constexpr (has_lazy_flags)
+    {
+      lazy_ = false;
+    }
+  }
+
+  // Set the carry and the auxiliary carry from carries, and the sign, zero and parity flags from
+  // result. With lazy flags, the latter are computed only when read.
+  void
+  set_flags(std::uint8_t carries, std::uint8_t result)
+  noexcept
+  {
+    if constexpr (has_lazy_flags)
+    {
+      psw_ = carries | psw_bit_1;
+      result_ = result;
+      lazy_ = true;
+    }
+    else
+    {
+      psw_ = carries | szp[result];
+    }
+  }
+
   [[nodiscard]]
   std::uint8_t
   inr(std::uint8_t value)
   noexcept
   {
     const std::uint8_t res = value + 1;
-    ac_ = (res & 0x0f) == 0;
-    z_ = res == 0;
-    s_ = (res & 0b10000000) != 0;
-    p_ = util::parity(res);
+    set_flags((psw_ & carry) | ((res & 0x0f) == 0 ? aux_carry : 0), res);
     return res;
   }
 
@@ -2319,37 +3185,57 @@ private:
   noexcept
   {
     const std::uint8_t res = value - 1;
-    ac_ = not ((res & 0x0f) == 0x0f);
-    z_ = res == 0;
-    s_ = (res & 0b10000000) != 0;
-    p_ = util::parity(res);
+    set_flags((psw_ & carry) | ((res & 0x0f) == 0x0f ? 0 : aux_carry), res);
     return res;
   }
 
+  // Set A and the flags from a result packed as (flags << 8) | result.
+  void
+  set_a_psw(std::uint16_t packed)
+  noexcept
+  {
+    a_ = packed & 0xff;
+    set_psw(packed >> 8);
+  }
+
   void
   adda(std::uint8_t val, bool carry)
   noexcept
   {
-    const std::uint16_t res = a_ + val + carry;
-    z_  = (res & 0xff) == 0;
-    s_  = (res & 0b10000000) != 0;
-    cy_ = (res & 0b100000000) != 0;
-    ac_ = (a_ ^ res ^ val) & 0x10;
-    p_  = util::parity(res & 0xff);
-    a_ = res & 0xff;
+    if constexpr (has_alu_tables)
+    {
+      set_a_psw(alu_tables::sums[carry << 16 | a_ << 8 | val]);
+    }
+    else if constexpr (has_lazy_flags)
+    {
+      const std::uint16_t res = a_ + val + carry;
+      set_flags(sum_carries(a_, val, res), res);
+      a_ = res;
+    }
+    else
+    {
+      set_a_psw(sum(a_, val, carry));
+    }
   }
 
   void
   suba(std::uint8_t val, bool carry)
   noexcept
   {
-    const std::int16_t res = a_ - val - carry;
-    z_ = (res & 0xff) == 0;
-    s_ = (res & 0b10000000) != 0;
-    cy_ = (res & 0b100000000) != 0;
-    ac_ = ~(a_ ^ res ^ val) & 0x10;
-    p_ = util::parity(res & 0xff);
-    a_ = res & 0xff;
+    if constexpr (has_alu_tables)
+    {
+      set_a_psw(alu_tables::differences[carry << 16 | a_ << 8 | val]);
+    }
+    else if constexpr (has_lazy_flags)
+    {
+      const std::uint16_t res = a_ - val - carry;
+      set_flags(difference_carries(a_, val, res), res);
+      a_ = res;
+    }
+    else
+    {
+      set_a_psw(difference(a_, val, carry));
+    }
   }
 
   void
@@ -2357,11 +3243,7 @@ private:
   noexcept
   {
     a_ |= val;
-    cy_ = false;
-    ac_ = false;
-    z_ = a_ == 0;
-    s_ = (a_ & 0x80) != 0;
-    p_ = util::parity(a_);
+    set_flags(0, a_);
   }
 
   void
@@ -2369,11 +3251,7 @@ private:
   noexcept
   {
     const std::uint8_t res = a_ & val;
-    cy_ = false;
-    ac_ = ((a_ | val) & 0x08) != 0;
-    z_ = res == 0;
-    s_ = (res & 0x80) != 0;
-    p_ = util::parity(res);
+    set_flags(((a_ | val) & 0x08) << 1, res);
     a_ = res;
   }
 
@@ -2382,23 +3260,26 @@ private:
   noexcept
   {
     a_ ^= val;
-    cy_ = false;
-    ac_ = false;
-    z_ = a_ == 0;
-    s_ = (a_ & 0x80) != 0;
-    p_ = util::parity(a_);
+    set_flags(0, a_);
   }
 
   void
   cmp(std::uint8_t val)
   noexcept
   {
-    const std::int16_t res = a_ - val;
-    cy_ = (res & 0b100000000) != 0;
-    ac_ = ~(a_ ^ res ^ val) & 0x10;
-    z_ = (res & 0xff) == 0;
-    s_ = (res & 0x80) != 0;
-    p_ = util::parity(res);
+    if constexpr (has_alu_tables)
+    {
+      set_psw(alu_tables::differences[a_ << 8 | val] >> 8);
+    }
+    else if constexpr (has_lazy_flags)
+    {
+      const std::uint16_t res = a_ - val;
+      set_flags(difference_carries(a_, val, res), res);
+    }
+    else
+    {
+      set_psw(difference(a_, val, false) >> 8);
+    }
   }
 
   void
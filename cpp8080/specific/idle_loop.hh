@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Registers and flags read and written by an instruction, and whether it has no other effect than
+// reading memory. Registers are bits numbered as in opcodes, m standing for h and l.
+struct loop_effects final
+{
+  bool pure;
+  int reads;
+  int writes;
+
+  static constexpr auto a = 1 << 7;
+  static constexpr auto m = 3 << 4;        // h and l
+  static constexpr auto carry = 1 << 8;
+  static constexpr auto flags = 1 << 9;    // zero, sign, parity and auxiliary carry
+
+  [[nodiscard]]
+  static constexpr
+  loop_effects
+  of(std::uint8_t opcode)
+  noexcept
+  {
+    const auto destination = (opcode >> 3) & 7;
+    const auto source = opcode & 7;
+
+    if (opcode >= 0x40 and opcode < 0x80) // mov, hlt
+    {
+      return {opcode != 0x76 and destination != 6, reg(source), reg(destination)};
+    }
+    if (opcode >= 0x80 and opcode < 0xc0) // add, adc, sub, sbb, ana, xra, ora, cmp
+    {
+      return alu(destination, reg(source));
+    }
+    if ((opcode & 0xc7) == 0xc6)          // adi, aci, sui, sbi, ani, xri, ori, cpi
+    {
+      return alu(destination, 0);
+    }
+    if ((opcode & 0xc7) == 0xc2)          // conditional jumps
+    {
+      return {true, destination == 2 or destination == 3 ? carry : flags, 0};
+    }
+    if (opcode < 0x40)
+    {
+      // Register pairs of lxi, inx, dcx and dad. Instructions on sp are left out.
+      const auto pair = 3 << (2 * (opcode >> 4));
+      switch (opcode & 0x0f)
+      {
+        case 0x01: return {opcode != 0x31, 0, pair};                    // lxi
+        case 0x03: case 0x0b: return {opcode < 0x30, pair, pair};       // inx, dcx
+        case 0x09: return {opcode != 0x39, pair | m, m | carry};        // dad
+        default: break;
+      }
+      switch (opcode & 0x07)
+      {
+        case 0x04: case 0x05:                                           // inr, dcr
+          return {destination != 6, reg(destination), reg(destination) | flags};
+        case 0x06:                                                      // mvi
+          return {destination != 6, 0, reg(destination)};
+        default: break;
+      }
+    }
+
+    switch (opcode)
+    {
+      case 0x00: return {true, 0, 0};                                   // nop
+      case 0x0a: return {true, reg(0) | reg(1), a};                     // ldax b
+      case 0x1a: return {true, reg(2) | reg(3), a};                     // ldax d
+      case 0x2a: return {true, 0, m};                                   // lhld
+      case 0x3a: return {true, 0, a};                                   // lda
+      case 0x07: case 0x0f: return {true, a, a | carry};                // rlc, rrc
+      case 0x17: case 0x1f: return {true, a | carry, a | carry};        // ral, rar
+      case 0x27: return {true, a | carry | flags, a | carry | flags};   // daa
+      case 0x2f: return {true, a, a};                                   // cma
+      case 0x37: return {true, 0, carry};                               // stc
+      case 0x3f: return {true, carry, carry};                           // cmc
+      case 0xc3: return {true, 0, 0};                                   // jmp
+      case 0xe9: return {true, m, 0};                                   // pchl
+      default: return {false, 0, 0};
+    }
+  }
+
+private:
+
+  [[nodiscard]]
+  static constexpr
+  int
+  reg(int code)
+  noexcept
+  {
+    return code == 6 ? m : 1 << code;
+  }
+
+  // add, adc, sub, sbb, ana, xra, ora and cmp of operand.
+  [[nodiscard]]
+  static constexpr
+  loop_effects
+  alu(int operation, int operand)
+  noexcept
+  {
+    const auto with_carry = operation == 1 or operation == 3;
+    return {true, a | operand | (with_carry ? carry : 0), (operation == 7 ? 0 : a) | carry | flags};
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Tell if the loop made of the opcodes from first to last, excluded, does the same thing at each
+// iteration, and thus never ends until memory is modified by other means than the loop, like an
+// interrupt handler. Such a loop only reads memory, and never reads a register or a flag that it
+// writes before having written it. Opcodes provided by the machine may have any effect.
+// Reads are only assumed to have no effect in the readable memory of the machine: the cpu doesn't
+// skip the iterations of loops which read memory elsewhere.
+template <typename Iterator>
+[[nodiscard]]
+constexpr
+bool
+is_idle_loop(Iterator first, Iterator last, const std::array<bool, 256>& overridden)
+noexcept
+{
+  auto loop_writes = 0;
+  for (auto it = first; it != last; ++it)
+  {
+    const auto effects = loop_effects::of(*it);
+    if (not effects.pure or overridden[*it])
+    {
+      return false;
+    }
+    loop_writes |= effects.writes;
+  }
+
+  auto writes = 0;
+  for (auto it = first; it != last; ++it)
+  {
+    const auto effects = loop_effects::of(*it);
+    if (effects.reads & loop_writes & ~writes)
+    {
+      return false;
+    }
+    writes |= effects.writes;
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional> // function
+#include <type_traits>
+#include <utility>    // declval, move
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The 256 ports reached by the in and out instructions. Each port is read and written either
+// directly in a host byte, a latch, or through handlers. Ports are looked up in a flat table
+// indexed by their number. Unmapped ports read as a default value, 0xff unless told otherwise, and
+// ignore writes.
+class io_bus final
+{
+public:
+
+  using read_handler = std::function<std::uint8_t (std::uint8_t)>;
+  using write_handler = std::function<void (std::uint8_t, std::uint8_t)>;
+
+  static constexpr auto nb_ports = std::size_t{256};
+
+public:
+
+  io_bus()
+    : ports_{}
+    , read_handlers_{}
+    , write_handlers_{}
+    , unmapped_input_{0xff}
+    , sink_{0}
+  {
+    for (auto& port : ports_)
+    {
+      port = {&unmapped_input_, &sink_};
+    }
+  }
+
+  // Ports point to the default input and to the sink of the bus.
+  io_bus(const io_bus&) = delete;
+  io_bus& operator=(const io_bus&) = delete;
+
+  // Read and write port in the host byte at latch.
+  void
+  latch(std::uint8_t port, std::uint8_t* latch)
+  noexcept
+  {
+    ports_[port] = {latch, latch};
+  }
+
+  // Read port in the host byte at latch.
+  void
+  latch_in(std::uint8_t port, const std::uint8_t* latch)
+  noexcept
+  {
+    ports_[port].read = latch;
+  }
+
+  // Write port in the host byte at latch.
+  void
+  latch_out(std::uint8_t port, std::uint8_t* latch)
+  noexcept
+  {
+    ports_[port].write = latch;
+  }
+
+  // Read port by calling handler.
+  void
+  on_in(std::uint8_t port, read_handler handler)
+  {
+    ports_[port].read = nullptr;
+    read_handlers_[port] = std::move(handler);
+  }
+
+  // Write port by calling handler.
+  void
+  on_out(std::uint8_t port, write_handler handler)
+  {
+    ports_[port].write = nullptr;
+    write_handlers_[port] = std::move(handler);
+  }
+
+  // Ignore writes to port, e.g. for a device which is not emulated.
+  void
+  ignore_out(std::uint8_t port)
+  noexcept
+  {
+    ports_[port].write = &sink_;
+  }
+
+  // Value read from unmapped ports.
+  void
+  unmapped_input(std::uint8_t value)
+  noexcept
+  {
+    unmapped_input_ = value;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  in(std::uint8_t port)
+  const
+  {
+    if (const auto latch = ports_[port].read)
+    {
+      return *latch;
+    }
+    return read_handlers_[port](port);
+  }
+
+  void
+  out(std::uint8_t port, std::uint8_t value)
+  {
+    if (const auto latch = ports_[port].write)
+    {
+      *latch = value;
+      return;
+    }
+    write_handlers_[port](port, value);
+  }
+
+private:
+
+  struct port
+  {
+    const std::uint8_t* read;
+    std::uint8_t* write;
+  };
+
+private:
+
+  std::array<port, nb_ports> ports_;
+  std::array<read_handler, nb_ports> read_handlers_;
+  std::array<write_handler, nb_ports> write_handlers_;
+  std::uint8_t unmapped_input_;
+  std::uint8_t sink_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A machine routes the in and out instructions to its ports by providing
+//   cpp8080::specific::io_bus& io_bus();
+// Otherwise, in and out do nothing but skipping their operand, unless the machine overrides them.
+template <typename Machine, typename = void>
+struct has_io_bus
+  : std::false_type
+{};
+
+template <typename Machine>
+struct has_io_bus<Machine, std::void_t<decltype(std::declval<Machine&>().io_bus())>>
+  : std::true_type
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
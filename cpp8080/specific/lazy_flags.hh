@@ -0,0 +1,23 @@
+#pragma once
+
+#include <type_traits>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A machine defers the computation of the sign, zero and parity flags until they are read, e.g. by
+// a conditional jump or push_psw, by declaring `static constexpr bool lazy_flags = true;`.
+template <typename Machine, typename = void>
+struct lazy_flags_enabled
+  : std::false_type
+{};
+
+template <typename Machine>
+struct lazy_flags_enabled<Machine, std::void_t<decltype(Machine::lazy_flags)>>
+  : std::bool_constant<Machine::lazy_flags>
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
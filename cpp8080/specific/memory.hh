@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility> // declval
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A machine accesses 16-bit words in a single call by providing
+//   std::uint16_t memory_read_word(std::uint16_t address);
+//   void memory_write_word(std::uint16_t address, std::uint16_t value);
+// The low byte is at address and the high byte at address + 1, which wraps around to 0. Otherwise,
+// words are accessed byte per byte.
+template <typename Machine, typename = void>
+struct has_memory_words
+  : std::false_type
+{};
+
+template <typename Machine>
+struct has_memory_words<
+  Machine,
+  std::void_t<
+    decltype(std::declval<Machine&>().memory_read_word(std::uint16_t{})),
+    decltype(std::declval<Machine&>().memory_write_word(std::uint16_t{}, std::uint16_t{}))>
+>
+  : std::true_type
+{};
+
+// Tell if the memory accesses of a machine never throw.
+template <typename Machine, typename = void>
+struct memory_noexcept
+  : std::bool_constant<
+      noexcept(std::declval<Machine&>().memory_read_byte(std::uint16_t{})) and
+      noexcept(std::declval<Machine&>().memory_write_byte(std::uint16_t{}, std::uint8_t{}))>
+{};
+
+template <typename Machine>
+struct memory_noexcept<Machine, std::enable_if_t<has_memory_words<Machine>::value>>
+  : std::bool_constant<
+      noexcept(std::declval<Machine&>().memory_read_byte(std::uint16_t{})) and
+      noexcept(std::declval<Machine&>().memory_write_byte(std::uint16_t{}, std::uint8_t{})) and
+      noexcept(std::declval<Machine&>().memory_read_word(std::uint16_t{})) and
+      noexcept(std::declval<Machine&>().memory_write_word(std::uint16_t{}, std::uint16_t{}))>
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Host memory holding the bytes of addresses from first to first + size, excluded.
+struct memory_region
+{
+  const std::uint8_t* data;
+  std::uint16_t first;
+  std::uint32_t size;
+
+  // Tell if bytes from address to address + count, excluded, are in the region.
+  [[nodiscard]]
+  bool
+  contains(std::uint16_t address, std::uint32_t count)
+  const noexcept
+  {
+    return static_cast<std::uint16_t>(address - first) + count <= size;
+  }
+
+  [[nodiscard]]
+  const std::uint8_t*
+  at(std::uint16_t address)
+  const noexcept
+  {
+    return data + static_cast<std::uint16_t>(address - first);
+  }
+};
+
+// A machine lets the cpu read memory directly, for instance to fetch instructions, by providing
+//   cpp8080::specific::memory_region readable_memory() const noexcept;
+// Reads outside of this region still go through memory_read_byte and memory_read_word. The region
+// is asked for at each read, so a machine may change it at any time.
+// Only reads in this region are assumed to have no side effect: loops which poll memory elsewhere
+// are executed at each iteration rather than skipped as idle loops.
+template <typename Machine, typename = void>
+struct has_readable_memory
+  : std::false_type
+{};
+
+template <typename Machine>
+struct has_readable_memory<
+  Machine,
+  std::void_t<decltype(std::declval<const Machine&>().readable_memory())>
+>
+  : std::true_type
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Read a little-endian word from host memory. Compilers turn it into a single unaligned load on
+// little-endian hosts.
+[[nodiscard]]
+inline
+std::uint16_t
+load_word(const std::uint8_t* bytes)
+noexcept
+{
+  return bytes[0] | (bytes[1] << 8);
+}
+
+// Write a little-endian word to host memory.
+inline
+void
+store_word(std::uint8_t* bytes, std::uint16_t value)
+noexcept
+{
+  bytes[0] = value & 0xff;
+  bytes[1] = value >> 8;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm> // copy_n
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The content of the pages of memory written by a cpu since its previous checkpoint. The first
+// checkpoint of a cpu holds the whole memory, and memory is rewound to any checkpoint by restoring
+// the first one and all the following ones in order. Checkpoints taken after it are then obsolete.
+class memory_checkpoint final
+{
+public:
+
+  static constexpr auto page_size = std::size_t{256};
+
+  // Save the pages written since the previous checkpoint of cpu, and start a new one.
+  template <typename Cpu>
+  [[nodiscard]]
+  static
+  memory_checkpoint
+  take(Cpu& cpu)
+  {
+    auto checkpoint = memory_checkpoint{};
+    const auto& dirty = cpu.dirty_pages();
+    checkpoint.pages_.reserve(dirty.count());
+    checkpoint.bytes_.reserve(dirty.count() * page_size);
+    for (auto page = std::size_t{0}; page < dirty.size(); ++page)
+    {
+      if (dirty[page])
+      {
+        checkpoint.pages_.push_back(static_cast<std::uint8_t>(page));
+        for (auto offset = std::size_t{0}; offset < page_size; ++offset)
+        {
+          checkpoint.bytes_.push_back(
+            cpu.memory_read_byte(static_cast<std::uint16_t>(page * page_size + offset)));
+        }
+      }
+    }
+    cpu.clear_dirty_pages();
+    return checkpoint;
+  }
+
+  // Write the saved pages back to host, the memory of cpu holding addresses from first to
+  // first + size, excluded. Pages outside of host, e.g. mirrors, are skipped. As restored pages hold
+  // the content of this checkpoint again, they are not dirty anymore, and decoded code is dropped
+  // from them.
+  template <typename Cpu>
+  void
+  restore(Cpu& cpu, std::uint8_t* host, std::uint16_t first, std::uint32_t size)
+  const
+  {
+    auto range_first = std::size_t{0};
+    auto range_last = std::size_t{0};
+    auto in_range = false;
+    const auto flush = [&]
+    {
+      if (in_range)
+      {
+        cpu.remap(static_cast<std::uint16_t>(range_first), static_cast<std::uint16_t>(range_last));
+        cpu.clear_dirty_pages(static_cast<std::uint16_t>(range_first),
+                              static_cast<std::uint16_t>(range_last));
+        in_range = false;
+      }
+    };
+    for (auto i = std::size_t{0}; i < pages_.size(); ++i)
+    {
+      const auto address = std::size_t{pages_[i]} * page_size;
+      if (address < first or address + page_size > first + size)
+      {
+        continue;
+      }
+      std::copy_n(bytes_.begin() + i * page_size, page_size, host + (address - first));
+      if (not in_range or address != range_last + 1)
+      {
+        flush();
+        range_first = address;
+        in_range = true;
+      }
+      range_last = address + page_size - 1;
+    }
+    flush();
+  }
+
+  // Pages held by this checkpoint.
+  [[nodiscard]]
+  const std::vector<std::uint8_t>&
+  pages()
+  const noexcept
+  {
+    return pages_;
+  }
+
+  // Number of bytes held by this checkpoint.
+  [[nodiscard]]
+  std::size_t
+  size()
+  const noexcept
+  {
+    return bytes_.size();
+  }
+
+private:
+
+  memory_checkpoint() = default;
+
+private:
+
+  std::vector<std::uint8_t> pages_;
+  std::vector<std::uint8_t> bytes_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
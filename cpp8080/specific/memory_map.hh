@@ -0,0 +1,277 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional> // function
+#include <stdexcept>  // invalid_argument
+#include <utility>    // pair
+
+#include "cpp8080/specific/memory.hh"
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The 64 KiB seen by the cpu, split in pages of 256 bytes. Each page is read and written by a
+// function with its context, looked up by the high byte of addresses: a trampoline on the page in
+// host memory, or a call of a handler, e.g. for read-only or memory-mapped I/O areas. Unmapped
+// pages read as 0xff and ignore writes.
+class memory_map final
+{
+public:
+
+  using read_handler = std::function<std::uint8_t (std::uint16_t)>;
+  using write_handler = std::function<void (std::uint16_t, std::uint8_t)>;
+
+  static constexpr auto page_size = std::uint32_t{256};
+  static constexpr auto nb_pages = std::size_t{256};
+
+public:
+
+  memory_map()
+    : pages_{}
+    , read_handlers_{}
+    , write_handlers_{}
+    , sink_{}
+    , discarded_writes_{0}
+  {
+    on_read(0x0000, 0xffff, [](std::uint16_t){return std::uint8_t{0xff};});
+    discard_writes(0x0000, 0xffff);
+  }
+
+  // Pages point to the sink of the map.
+  memory_map(const memory_map&) = delete;
+  memory_map& operator=(const memory_map&) = delete;
+
+  // Read and write addresses from first to last, both included, in host memory, which holds the
+  // byte of first at host[0]. The range must start and end on page boundaries. Several ranges may
+  // be mapped to the same host memory, to mirror it.
+  void
+  map(std::uint16_t first, std::uint16_t last, std::uint8_t* host)
+  {
+    map_read(first, last, host);
+    map_write(first, last, host);
+  }
+
+  // Read addresses from first to last, both included, in host memory.
+  void
+  map_read(std::uint16_t first, std::uint16_t last, const std::uint8_t* host)
+  {
+    const auto [first_page, last_page] = pages(first, last);
+    for (auto page = first_page; page <= last_page; ++page)
+    {
+      pages_[page].read = &read_host;
+      pages_[page].read_context = host + (page - first_page) * page_size;
+    }
+  }
+
+  // Write addresses from first to last, both included, in host memory.
+  void
+  map_write(std::uint16_t first, std::uint16_t last, std::uint8_t* host)
+  {
+    map_write_pages(first, last, host, page_size);
+  }
+
+  // Read and write addresses from first to last, both included, in bank number bank of banks, which
+  // are stored one after the other in host memory. Only the pages of these addresses are updated,
+  // whatever the number of banks, and no memory is copied. The cpu must then be told with
+  // cpu::remap(first, last).
+  void
+  map_bank(std::uint16_t first, std::uint16_t last, std::uint8_t* banks, std::size_t bank)
+  {
+    map(first, last, banks + bank * bank_size(first, last));
+  }
+
+  // Read addresses from first to last, both included, in bank number bank of read-only banks.
+  void
+  map_read_bank(std::uint16_t first, std::uint16_t last, const std::uint8_t* banks,
+                std::size_t bank)
+  {
+    map_read(first, last, banks + bank * bank_size(first, last));
+  }
+
+  // Read addresses from first to last, both included, by calling handler.
+  void
+  on_read(std::uint16_t first, std::uint16_t last, read_handler handler)
+  {
+    const auto [first_page, last_page] = pages(first, last);
+    for (auto page = first_page; page <= last_page; ++page)
+    {
+      read_handlers_[page] = handler;
+      pages_[page].read = &read_handler_page;
+      pages_[page].read_context = &read_handlers_[page];
+    }
+  }
+
+  // Write addresses from first to last, both included, by calling handler. It may for instance
+  // trap writes to read-only memory into a debugger.
+  void
+  on_write(std::uint16_t first, std::uint16_t last, write_handler handler)
+  {
+    const auto [first_page, last_page] = pages(first, last);
+    for (auto page = first_page; page <= last_page; ++page)
+    {
+      write_handlers_[page] = handler;
+      pages_[page].write = &write_handler_page;
+      pages_[page].write_context = &write_handlers_[page];
+    }
+  }
+
+  // Discard writes to addresses from first to last, both included. They go to a sink page, so
+  // that they cost no more than writes to RAM.
+  void
+  discard_writes(std::uint16_t first, std::uint16_t last)
+  {
+    map_write_pages(first, last, sink_.data(), 0);
+  }
+
+  // Discard writes to addresses from first to last, both included, and count them.
+  void
+  count_writes(std::uint16_t first, std::uint16_t last)
+  {
+    on_write(first, last, [this](std::uint16_t, std::uint8_t){++discarded_writes_;});
+  }
+
+  // Number of writes discarded by ranges given to count_writes.
+  [[nodiscard]]
+  std::uint64_t
+  discarded_writes()
+  const noexcept
+  {
+    return discarded_writes_;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  read_byte(std::uint16_t address)
+  const
+  {
+    const auto& page = pages_[address >> 8];
+    return page.read(page.read_context, address);
+  }
+
+  void
+  write_byte(std::uint16_t address, std::uint8_t value)
+  {
+    const auto& page = pages_[address >> 8];
+    page.write(page.write_context, address, value);
+  }
+
+  // Read the word whose low byte is at address, and high byte at address + 1.
+  [[nodiscard]]
+  std::uint16_t
+  read_word(std::uint16_t address)
+  const
+  {
+    if (const auto& page = pages_[address >> 8];
+        page.read == &read_host and (address & 0xff) != 0xff)
+    {
+      return load_word(static_cast<const std::uint8_t*>(page.read_context) + (address & 0xff));
+    }
+    return read_byte(address) | (read_byte(static_cast<std::uint16_t>(address + 1)) << 8);
+  }
+
+  // Write value at address and its high byte at address + 1.
+  void
+  write_word(std::uint16_t address, std::uint16_t value)
+  {
+    if (const auto& page = pages_[address >> 8];
+        page.write == &write_host and (address & 0xff) != 0xff)
+    {
+      store_word(static_cast<std::uint8_t*>(page.write_context) + (address & 0xff), value);
+      return;
+    }
+    write_byte(address, value & 0xff);
+    write_byte(static_cast<std::uint16_t>(address + 1), value >> 8);
+  }
+
+private:
+
+  struct page
+  {
+    std::uint8_t (*read)(const void* context, std::uint16_t address);
+    const void* read_context;
+    void (*write)(void* context, std::uint16_t address, std::uint8_t value);
+    void* write_context;
+  };
+
+  // Read a page in host memory, context being its first byte.
+  static
+  std::uint8_t
+  read_host(const void* context, std::uint16_t address)
+  noexcept
+  {
+    return static_cast<const std::uint8_t*>(context)[address & 0xff];
+  }
+
+  // Write a page in host memory, context being its first byte.
+  static
+  void
+  write_host(void* context, std::uint16_t address, std::uint8_t value)
+  noexcept
+  {
+    static_cast<std::uint8_t*>(context)[address & 0xff] = value;
+  }
+
+  // Read a page with the handler context points to.
+  static
+  std::uint8_t
+  read_handler_page(const void* context, std::uint16_t address)
+  {
+    return (*static_cast<const read_handler*>(context))(address);
+  }
+
+  // Write a page with the handler context points to.
+  static
+  void
+  write_handler_page(void* context, std::uint16_t address, std::uint8_t value)
+  {
+    (*static_cast<write_handler*>(context))(address, value);
+  }
+
+  // Write the pages from first to last in host, each page stride bytes after the previous one.
+  void
+  map_write_pages(std::uint16_t first, std::uint16_t last, std::uint8_t* host, std::size_t stride)
+  {
+    const auto [first_page, last_page] = pages(first, last);
+    for (auto page = first_page; page <= last_page; ++page)
+    {
+      pages_[page].write = &write_host;
+      pages_[page].write_context = host + (page - first_page) * stride;
+    }
+  }
+
+  [[nodiscard]]
+  static
+  std::size_t
+  bank_size(std::uint16_t first, std::uint16_t last)
+  noexcept
+  {
+    return std::size_t{last} - first + 1;
+  }
+
+  // The first and the last pages of a range of addresses.
+  [[nodiscard]]
+  static
+  std::pair<std::size_t, std::size_t>
+  pages(std::uint16_t first, std::uint16_t last)
+  {
+    if (first % page_size != 0 or (last + 1) % page_size != 0 or first > last)
+    {
+      throw std::invalid_argument{"Memory ranges must start and end on page boundaries"};
+    }
+    return {first / page_size, last / page_size};
+  }
+
+private:
+
+  std::array<page, nb_pages> pages_;
+  std::array<read_handler, nb_pages> read_handlers_;
+  std::array<write_handler, nb_pages> write_handlers_;
+  std::array<std::uint8_t, page_size> sink_;
+  std::uint64_t discarded_writes_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+enum class stop_reason
+{
+  budget,       // The cycle budget has been consumed.
+  requested,    // An instruction called cpu::stop().
+  halted,       // A hlt instruction has been executed.
+  unimplemented // An opcode without instruction has been executed.
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct run_result final
+{
+  std::uint64_t cycles;
+  stop_reason reason;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
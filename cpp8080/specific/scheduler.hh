@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>  // find_if, make_heap, pop_heap, push_heap
+#include <cstdint>
+#include <functional> // function
+#include <limits>
+#include <utility>    // move
+#include <vector>
+
+#include "cpp8080/specific/run_result.hh"
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Events of the devices of a machine, e.g. timers, video beams or serial lines, dated in cycles of
+// the cpu and kept in a min-heap. run() executes the cpu in slices ending at the next event, so
+// that the cpu itself never checks for them.
+// Events are fired as soon as the cpu has reached their cycle, which it may exceed by the end of an
+// instruction. Events scheduled while a slice runs, e.g. by a port handler, are fired at its end at
+// the earliest. Events of the same cycle are fired in the order they were scheduled.
+class scheduler final
+{
+public:
+
+  using callback = std::function<void ()>;
+  using event_id = std::uint64_t;
+
+public:
+
+  scheduler()
+    : events_{}
+    , now_{0}
+    , next_id_{0}
+    , firing_{no_event}
+  {}
+
+  // Fire callback at cycle.
+  event_id
+  at(std::uint64_t cycle, callback fn)
+  {
+    return push(cycle, 0, std::move(fn));
+  }
+
+  // Fire callback delay cycles from now.
+  event_id
+  after(std::uint64_t delay, callback fn)
+  {
+    return push(now_ + delay, 0, std::move(fn));
+  }
+
+  // Fire callback every period cycles, starting period cycles from now. As the next occurrence is
+  // dated from the cycle of the previous one, the period doesn't drift with the cpu exceeding it.
+  event_id
+  every(std::uint64_t period, callback fn)
+  {
+    return every(period, period, std::move(fn));
+  }
+
+  // Fire callback every period cycles, starting delay cycles from now.
+  event_id
+  every(std::uint64_t period, std::uint64_t delay, callback fn)
+  {
+    return push(now_ + delay, period, std::move(fn));
+  }
+
+  // Remove the event id, if it has not been fired yet or is periodic. Return false otherwise.
+  bool
+  cancel(event_id id)
+  {
+    if (id == firing_)
+    {
+      firing_ = no_event;
+      return true;
+    }
+    const auto it = std::find_if(events_.begin(), events_.end(),
+                                 [id](const auto& e){return e.id == id;});
+    if (it == events_.end())
+    {
+      return false;
+    }
+    events_.erase(it);
+    std::make_heap(events_.begin(), events_.end(), later);
+    return true;
+  }
+
+  // Cycle of the next event, or the maximal cycle if there is none.
+  [[nodiscard]]
+  std::uint64_t
+  next()
+  const noexcept
+  {
+    return events_.empty() ? std::numeric_limits<std::uint64_t>::max() : events_.front().cycle;
+  }
+
+  // The cycle reached by the cpu after the last slice executed by run().
+  [[nodiscard]]
+  std::uint64_t
+  now()
+  const noexcept
+  {
+    return now_;
+  }
+
+  // Execute cpu for at least budget cycles, firing events as their cycles are reached, those of
+  // the last cycle included. Stop early, like cpu::run(), if an instruction stops the cpu.
+  template <typename Cpu>
+  run_result
+  run(Cpu& cpu, std::uint64_t budget)
+  {
+    return run_until(cpu, cpu.cycles() + budget);
+  }
+
+  // Execute cpu until it reaches cycle, e.g. the end of a frame, firing events as their cycles are
+  // reached, those of cycle included. As this cycle doesn't depend on how much the cpu exceeded the
+  // previous one, it stays in step with periodic events.
+  template <typename Cpu>
+  run_result
+  run_until(Cpu& cpu, std::uint64_t cycle)
+  {
+    now_ = cpu.cycles();
+    const auto start = now_;
+    fire();
+    while (now_ < cycle)
+    {
+      const auto result = cpu.run(std::min(next(), cycle) - now_);
+      now_ = cpu.cycles();
+      fire();
+      if (result.reason != stop_reason::budget)
+      {
+        return {now_ - start, result.reason};
+      }
+    }
+    return {now_ - start, stop_reason::budget};
+  }
+
+private:
+
+  static constexpr auto no_event = std::numeric_limits<event_id>::max();
+
+  struct event
+  {
+    std::uint64_t cycle;
+    std::uint64_t period; // 0 if fired only once
+    event_id id;
+    callback fn;
+  };
+
+  // Order of the heap, which has the earliest event at its front.
+  [[nodiscard]]
+  static
+  bool
+  later(const event& lhs, const event& rhs)
+  noexcept
+  {
+    return lhs.cycle != rhs.cycle ? lhs.cycle > rhs.cycle : lhs.id > rhs.id;
+  }
+
+  event_id
+  push(std::uint64_t cycle, std::uint64_t period, callback fn)
+  {
+    const auto id = next_id_++;
+    events_.push_back({cycle, period, id, std::move(fn)});
+    std::push_heap(events_.begin(), events_.end(), later);
+    return id;
+  }
+
+  // Fire the events whose cycle has been reached. Periodic events are scheduled again once fired,
+  // with their callback moved back into the heap, unless they have cancelled themselves.
+  void
+  fire()
+  {
+    while (not events_.empty() and events_.front().cycle <= now_)
+    {
+      std::pop_heap(events_.begin(), events_.end(), later);
+      auto e = std::move(events_.back());
+      events_.pop_back();
+      firing_ = e.id;
+      e.fn();
+      if (e.period != 0 and firing_ == e.id)
+      {
+        events_.push_back({e.cycle + e.period, e.period, e.id, std::move(e.fn)});
+        std::push_heap(events_.begin(), events_.end(), later);
+      }
+      firing_ = no_event;
+    }
+  }
+
+private:
+
+  std::vector<event> events_;
+  std::uint64_t now_;
+  event_id next_id_;
+  event_id firing_; // the event whose callback is being called, no_event if cancelled by it
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
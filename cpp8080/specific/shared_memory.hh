@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>      // memcpy
+#include <new>          // placement new
+#include <optional>
+#include <stdexcept>    // runtime_error
+#include <string>
+#include <system_error>
+#include <thread>       // this_thread::yield
+#include <utility>      // move
+
+#if defined(__unix__)
+#include <fcntl.h>      // O_*
+#include <sys/mman.h>
+#include <unistd.h>     // close, ftruncate
+#define CPP8080_HAS_SHARED_MEMORY 1
+#else
+#define CPP8080_HAS_SHARED_MEMORY 0
+#endif
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// What a shared memory segment starts with. The 64 KiB of emulated memory follow, at offset
+// shared_memory_header::memory_offset.
+// The sequence number is odd while the emulator writes memory. A consistent sample is one
+// read between two equal and even values of the sequence number.
+struct shared_memory_header
+{
+  static constexpr auto memory_offset = std::size_t{4096};
+  static constexpr auto memory_size = std::size_t{65536};
+  static constexpr auto segment_size = memory_offset + memory_size;
+
+  char magic[8];                      // "cpp8080"
+  std::uint32_t version;
+  std::uint32_t size;                 // of the emulated memory
+  std::atomic<std::uint32_t> sequence;
+  std::atomic<std::uint64_t> frame;   // incremented each time the emulator ends writing
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+// Map a POSIX shared memory segment.
+inline
+void*
+map_shared_memory(const std::string& name, bool writable)
+{
+#if CPP8080_HAS_SHARED_MEMORY
+  const auto fd = ::shm_open(name.c_str(), writable ? O_CREAT | O_RDWR : O_RDONLY, 0644);
+  if (fd == -1)
+  {
+    throw std::system_error{errno, std::generic_category(), "Cannot open shared memory " + name};
+  }
+  // Don't leave behind a segment created for the emulator if it cannot be used.
+  const auto fail = [&](int error, const char* what)
+  {
+    ::close(fd);
+    if (writable)
+    {
+      ::shm_unlink(name.c_str());
+    }
+    throw std::system_error{error, std::generic_category(), what + name};
+  };
+  if (writable and ::ftruncate(fd, shared_memory_header::segment_size) == -1)
+  {
+    fail(errno, "Cannot size shared memory ");
+  }
+  const auto segment = ::mmap(nullptr, shared_memory_header::segment_size,
+                              writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  if (segment == MAP_FAILED)
+  {
+    fail(errno, "Cannot map shared memory ");
+  }
+  ::close(fd);
+  return segment;
+#else
+  static_cast<void>(writable);
+  throw std::runtime_error{"Shared memory is not supported, cannot export " + name};
+#endif
+}
+
+inline
+void
+unmap_shared_memory(void* segment)
+noexcept
+{
+#if CPP8080_HAS_SHARED_MEMORY
+  ::munmap(segment, shared_memory_header::segment_size);
+#else
+  static_cast<void>(segment);
+#endif
+}
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Emulated memory living in a POSIX shared memory segment, so that other processes of the host
+// can map it read-only with shared_memory_reader. The emulator brackets its writes with
+// begin_write() and end_write(), e.g. around each frame, and never waits for readers.
+class shared_memory final
+{
+public:
+
+  // Create the segment named name, e.g. "/space_invaders". It's removed by the destructor.
+  explicit
+  shared_memory(std::string name)
+    : name_{std::move(name)}
+    , segment_{detail::map_shared_memory(name_, true)}
+  {
+    const auto header = new (segment_) shared_memory_header{};
+    std::memcpy(header->magic, "cpp8080", sizeof(header->magic));
+    header->version = 1;
+    header->size = shared_memory_header::memory_size;
+  }
+
+  ~shared_memory()
+  {
+    detail::unmap_shared_memory(segment_);
+#if CPP8080_HAS_SHARED_MEMORY
+    ::shm_unlink(name_.c_str());
+#endif
+  }
+
+  shared_memory(const shared_memory&) = delete;
+  shared_memory& operator=(const shared_memory&) = delete;
+
+  // The 64 KiB of emulated memory.
+  [[nodiscard]]
+  std::uint8_t*
+  memory()
+  const noexcept
+  {
+    return static_cast<std::uint8_t*>(segment_) + shared_memory_header::memory_offset;
+  }
+
+  void
+  begin_write()
+  noexcept
+  {
+    auto& sequence = header().sequence;
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void
+  end_write()
+  noexcept
+  {
+    header().frame.fetch_add(1, std::memory_order_relaxed);
+    auto& sequence = header().sequence;
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+private:
+
+  [[nodiscard]]
+  shared_memory_header&
+  header()
+  const noexcept
+  {
+    return *static_cast<shared_memory_header*>(segment_);
+  }
+
+private:
+
+  std::string name_;
+  void* segment_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Read-only view of memory exported by another process with shared_memory.
+class shared_memory_reader final
+{
+public:
+
+  static constexpr auto default_attempts = std::size_t{1000};
+
+public:
+
+  explicit
+  shared_memory_reader(const std::string& name)
+    : segment_{detail::map_shared_memory(name, false)}
+  {}
+
+  ~shared_memory_reader()
+  {
+    detail::unmap_shared_memory(const_cast<void*>(segment_));
+  }
+
+  shared_memory_reader(const shared_memory_reader&) = delete;
+  shared_memory_reader& operator=(const shared_memory_reader&) = delete;
+
+  // Copy size bytes of emulated memory from address to destination, as they were between two
+  // writes of the emulator. Return the number of the frame they belong to, or nothing if no
+  // consistent copy could be made in attempts tries, e.g. because the emulator stopped while
+  // writing. The reader yields to other threads between two tries.
+  // address + size must not exceed 64 KiB.
+  [[nodiscard]]
+  std::optional<std::uint64_t>
+  sample(std::uint16_t address, std::size_t size, std::uint8_t* destination,
+         std::size_t attempts = default_attempts)
+  const noexcept
+  {
+    const auto& header = *static_cast<const shared_memory_header*>(segment_);
+    const auto memory = static_cast<const std::uint8_t*>(segment_)
+                      + shared_memory_header::memory_offset;
+    for (auto attempt = std::size_t{0}; attempt < attempts; ++attempt)
+    {
+      if (attempt != 0)
+      {
+        std::this_thread::yield();
+      }
+      const auto before = header.sequence.load(std::memory_order_acquire);
+      if (before & 1)
+      {
+        continue;
+      }
+      const auto frame = header.frame.load(std::memory_order_relaxed);
+      std::memcpy(destination, memory + address, size);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (header.sequence.load(std::memory_order_relaxed) == before)
+      {
+        return frame;
+      }
+    }
+    return {};
+  }
+
+  // The emulated memory, which may be changing while it's read.
+  [[nodiscard]]
+  const std::uint8_t*
+  memory()
+  const noexcept
+  {
+    return static_cast<const std::uint8_t*>(segment_) + shared_memory_header::memory_offset;
+  }
+
+private:
+
+  const void* segment_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
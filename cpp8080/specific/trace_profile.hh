@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// What traces are recorded from: how many times each decoded block has been entered, which block
+// followed it the last time it has been executed to its end, and where code has been modified.
+class trace_profile final
+{
+public:
+
+  trace_profile()
+    : heat_(65536, 0)
+    , successors_(65536, no_successor)
+    , written_{}
+  {}
+
+  // Count an entry in the block starting at address, tell if it's time to record a trace from it.
+  [[nodiscard]]
+  bool
+  hot(std::uint16_t address)
+  noexcept
+  {
+    auto& heat = heat_[address];
+    return heat < threshold and ++heat == threshold;
+  }
+
+  // A new block has been decoded at address.
+  void
+  reset(std::uint16_t address)
+  noexcept
+  {
+    heat_[address] = 0;
+  }
+
+  // Never record a trace from the block starting at address, until it's reset.
+  void
+  exclude(std::uint16_t address)
+  noexcept
+  {
+    heat_[address] = threshold;
+  }
+
+  // The block starting at address has been followed by the one starting at successor.
+  void
+  follow(std::uint16_t address, std::uint16_t successor)
+  noexcept
+  {
+    successors_[address] = successor;
+  }
+
+  [[nodiscard]]
+  std::optional<std::uint16_t>
+  successor(std::uint16_t address)
+  const noexcept
+  {
+    if (const auto successor = successors_[address]; successor != no_successor)
+    {
+      return static_cast<std::uint16_t>(successor);
+    }
+    return std::nullopt;
+  }
+
+  // Code at address has been modified.
+  void
+  write(std::uint16_t address)
+  noexcept
+  {
+    written_[address >> 3] |= 1 << (address & 7);
+  }
+
+  // Tell if code from first to last, both included, has ever been modified.
+  [[nodiscard]]
+  bool
+  written(std::uint16_t first, std::uint16_t last)
+  const noexcept
+  {
+    for (auto address = first; ; ++address)
+    {
+      if (written_[address >> 3] & (1 << (address & 7)))
+      {
+        return true;
+      }
+      if (address == last)
+      {
+        return false;
+      }
+    }
+  }
+
+private:
+
+  // Number of entries after which a trace is recorded.
+  static constexpr auto threshold = std::uint8_t{8};
+
+  static constexpr auto no_successor = std::uint32_t{0x10000};
+
+  std::vector<std::uint8_t> heat_;
+  std::vector<std::uint32_t> successors_;
+  std::array<std::uint8_t, 8192> written_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>    // logic_error, runtime_error
+#include <system_error>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>     // sysconf
+#define CPP8080_HAS_WATCHPOINTS 1
+#else
+#define CPP8080_HAS_WATCHPOINTS 0
+#endif
+
+namespace cpp8080::specific {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A write to a watched address.
+struct watchpoint_hit
+{
+  std::uint16_t pc;       // of the instruction following the one which wrote
+  std::uint16_t address;
+  std::uint8_t old_value;
+  std::uint8_t value;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Watch writes to emulated memory living in host memory, at no cost for the other accesses.
+// The host pages holding watched addresses are made read-only. A write to such a page raises
+// SIGSEGV: the page is made writable again, the write is single-stepped, and the page is
+// protected again once it's done, in the SIGTRAP which follows. Writes to unwatched addresses of
+// these pages are slowed down as well, but not reported.
+// The emulator writes one or two bytes at once, and the fault only tells the first one: a watched
+// address is reported when it's the first one, or when it follows it and its value has changed.
+// As signal handlers can't safely call arbitrary code, hits are recorded and handed over by
+// report(), e.g. after each call to cpu::run().
+// Signal handlers are global, so only one instance may exist at a time, and the emulation must
+// run on a single thread. Only x86-64 Linux is supported, the constructor throws elsewhere.
+template <typename Cpu>
+class watchpoints final
+{
+public:
+
+  // Addresses from first to first + size, excluded, are written by cpu in host memory at host.
+  watchpoints(const Cpu& cpu, std::uint8_t* host, std::uint16_t first, std::uint32_t size)
+    : cpu_{cpu}
+    , host_{host}
+    , first_{first}
+    , size_{size}
+    , page_size_{0}
+    , first_page_{0}
+    , watched_{}
+    , protected_{}
+    , hits_{}
+    , nb_hits_{0}
+  {
+#if CPP8080_HAS_WATCHPOINTS
+    if (active_)
+    {
+      throw std::logic_error{"Only one watchpoints instance may exist at a time"};
+    }
+    page_size_ = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    first_page_ = reinterpret_cast<std::uintptr_t>(host) & ~(page_size_ - 1);
+    const auto last_page = (reinterpret_cast<std::uintptr_t>(host) + size - 1) & ~(page_size_ - 1);
+    protected_.resize((last_page - first_page_) / page_size_ + 1, 0);
+
+    struct sigaction action = {};
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    action.sa_sigaction = &on_segv;
+    if (::sigaction(SIGSEGV, &action, &previous_segv_) == -1)
+    {
+      throw std::system_error{errno, std::generic_category(), "Cannot handle SIGSEGV"};
+    }
+    action.sa_sigaction = &on_trap;
+    if (::sigaction(SIGTRAP, &action, &previous_trap_) == -1)
+    {
+      const auto error = errno;
+      ::sigaction(SIGSEGV, &previous_segv_, nullptr);
+      throw std::system_error{error, std::generic_category(), "Cannot handle SIGTRAP"};
+    }
+    active_ = this;
+#else
+    throw std::runtime_error{"Watchpoints are not supported on this platform"};
+#endif
+  }
+
+  ~watchpoints()
+  {
+#if CPP8080_HAS_WATCHPOINTS
+    for (auto i = std::size_t{0}; i < protected_.size(); ++i)
+    {
+      if (protected_[i])
+      {
+        protect(first_page_ + i * page_size_, false);
+      }
+    }
+    ::sigaction(SIGSEGV, &previous_segv_, nullptr);
+    ::sigaction(SIGTRAP, &previous_trap_, nullptr);
+    active_ = nullptr;
+#endif
+  }
+
+  watchpoints(const watchpoints&) = delete;
+  watchpoints& operator=(const watchpoints&) = delete;
+
+  void
+  watch(std::uint16_t address)
+  {
+    if (watched_[address] or not in_range(address))
+    {
+      return;
+    }
+    watched_[address] = true;
+    const auto page = host_page(address);
+    if (protected_[index(page)]++ == 0)
+    {
+      protect(page, true);
+    }
+  }
+
+  void
+  unwatch(std::uint16_t address)
+  {
+    if (not watched_[address])
+    {
+      return;
+    }
+    watched_[address] = false;
+    const auto page = host_page(address);
+    if (--protected_[index(page)] == 0)
+    {
+      protect(page, false);
+    }
+  }
+
+  // Call fn with each watchpoint_hit recorded since the previous call. Hits beyond the capacity of
+  // the record are dropped, their number is returned.
+  template <typename Fn>
+  std::size_t
+  report(Fn&& fn)
+  {
+    const auto nb_hits = nb_hits_.exchange(0);
+    for (auto i = std::size_t{0}; i < nb_hits and i < hits_.size(); ++i)
+    {
+      fn(hits_[i]);
+    }
+    return nb_hits > hits_.size() ? nb_hits - hits_.size() : 0;
+  }
+
+private:
+
+  [[nodiscard]]
+  bool
+  in_range(std::uint16_t address)
+  const noexcept
+  {
+    return static_cast<std::uint16_t>(address - first_) < size_;
+  }
+
+  [[nodiscard]]
+  std::uint8_t*
+  host_address(std::uint16_t address)
+  const noexcept
+  {
+    return host_ + static_cast<std::uint16_t>(address - first_);
+  }
+
+  [[nodiscard]]
+  std::uintptr_t
+  host_page(std::uint16_t address)
+  const noexcept
+  {
+    return reinterpret_cast<std::uintptr_t>(host_address(address)) & ~(page_size_ - 1);
+  }
+
+  [[nodiscard]]
+  std::size_t
+  index(std::uintptr_t page)
+  const noexcept
+  {
+    return (page - first_page_) / page_size_;
+  }
+
+  void
+  protect(std::uintptr_t page, bool read_only)
+  const noexcept
+  {
+#if CPP8080_HAS_WATCHPOINTS
+    ::mprotect(reinterpret_cast<void*>(page), page_size_,
+               read_only ? PROT_READ : PROT_READ | PROT_WRITE);
+#else
+    static_cast<void>(page);
+    static_cast<void>(read_only);
+#endif
+  }
+
+#if CPP8080_HAS_WATCHPOINTS
+
+  // The trap flag of x86-64, which raises SIGTRAP after the next instruction.
+  static constexpr auto trap_flag = greg_t{0x100};
+
+  static
+  void
+  on_segv(int signal, siginfo_t* info, void* context)
+  {
+    auto& self = *active_;
+    const auto fault = reinterpret_cast<std::uintptr_t>(info->si_addr);
+    const auto page = fault & ~(self.page_size_ - 1);
+    if (page < self.first_page_ or self.index(page) >= self.protected_.size()
+        or self.protected_[self.index(page)] == 0)
+    {
+      // Not caused by a watchpoint: let the fault happen again with the previous handler.
+      ::sigaction(signal, &self.previous_segv_, nullptr);
+      return;
+    }
+
+    // A write straddling two pages faults once for each.
+    if (self.nb_stepping_pages_ < self.stepping_pages_.size())
+    {
+      self.stepping_pages_[self.nb_stepping_pages_++] = page;
+    }
+    const auto offset = fault - reinterpret_cast<std::uintptr_t>(self.host_);
+    for (auto i = std::uintptr_t{0}; i < 2; ++i)
+    {
+      if (offset + i < self.size_ and self.nb_candidates_ < self.candidates_.size())
+      {
+        const auto address = static_cast<std::uint16_t>(self.first_ + offset + i);
+        if (self.watched_[address] and not self.is_candidate(address))
+        {
+          self.candidates_[self.nb_candidates_++] = {address, self.host_[offset + i], i == 0};
+        }
+      }
+    }
+    self.protect(page, false);
+    static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL] |= trap_flag;
+  }
+
+  [[nodiscard]]
+  bool
+  is_candidate(std::uint16_t address)
+  const noexcept
+  {
+    for (auto i = std::size_t{0}; i < nb_candidates_; ++i)
+    {
+      if (candidates_[i].address == address)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static
+  void
+  on_trap(int signal, siginfo_t*, void* context)
+  {
+    auto& self = *active_;
+    if (self.nb_stepping_pages_ == 0)
+    {
+      ::sigaction(signal, &self.previous_trap_, nullptr);
+      ::raise(signal);
+      return;
+    }
+
+    static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EFL] &= ~trap_flag;
+    for (auto i = std::size_t{0}; i < self.nb_stepping_pages_; ++i)
+    {
+      self.protect(self.stepping_pages_[i], true);
+    }
+    self.nb_stepping_pages_ = 0;
+
+    for (auto i = std::size_t{0}; i < self.nb_candidates_; ++i)
+    {
+      const auto& candidate = self.candidates_[i];
+      const auto value = *self.host_address(candidate.address);
+      if (candidate.exact or value != candidate.old_value)
+      {
+        if (const auto hit = self.nb_hits_.fetch_add(1); hit < self.hits_.size())
+        {
+          self.hits_[hit] = {self.cpu_.pc(), candidate.address, candidate.old_value, value};
+        }
+      }
+    }
+    self.nb_candidates_ = 0;
+  }
+
+  static inline watchpoints* active_ = nullptr;
+  struct sigaction previous_segv_;
+  struct sigaction previous_trap_;
+
+#endif
+
+private:
+
+  const Cpu& cpu_;
+  std::uint8_t* host_;
+  std::uint16_t first_;
+  std::uint32_t size_;
+  std::uintptr_t page_size_;
+  std::uintptr_t first_page_;
+  std::array<bool, 65536> watched_;
+  std::vector<int> protected_; // for each host page, the number of watched addresses it holds
+  std::array<watchpoint_hit, 1024> hits_;
+  std::atomic<std::size_t> nb_hits_;
+
+  // The write being single-stepped: the pages it has made writable, which are two at most when it
+  // straddles them, and the watched addresses it may modify.
+  struct candidate
+  {
+    std::uint16_t address;
+    std::uint8_t old_value;
+    bool exact; // the faulting address
+  };
+
+  std::array<std::uintptr_t, 2> stepping_pages_ = {};
+  std::size_t nb_stepping_pages_ = 0;
+  std::array<candidate, 4> candidates_ = {};
+  std::size_t nb_candidates_ = 0;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cpp8080::specific
@@ -5,7 +5,7 @@ namespace cpp8080::util {
 /*------------------------------------------------------------------------------------------------*/
 
 [[nodiscard]]
-inline
+constexpr
 bool
 parity(std::uint8_t x)
 noexcept
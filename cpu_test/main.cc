@@ -21,26 +21,6 @@
 
 /*------------------------------------------------------------------------------------------------*/
 
-struct timeout
-{
-  std::atomic<bool>& stop;
-
-  template <typename Cpu, typename Instruction>
-  void pre(const Cpu&, Instruction) const
-  {
-    if (stop)
-    {
-      throw std::runtime_error{"Timeout"};
-    }
-  }
-
-  template <typename Cpu, typename Instruction>
-  void post(const Cpu&, Instruction) const noexcept
-  {}
-};
-
-/*------------------------------------------------------------------------------------------------*/
-
 class cpu_test
 {
 private:
@@ -85,6 +65,14 @@ public:
 
   using overrides = cpp8080::meta::make_instructions<call>;
 
+  // The cpu_test_alu_tables and cpu_test_lazy_flags variants check the other policies of the ALU.
+#if defined(CPP8080_CPU_TEST_ALU_TABLES)
+  static constexpr bool alu_tables = true;
+#endif
+#if defined(CPP8080_CPU_TEST_LAZY_FLAGS)
+  static constexpr bool lazy_flags = true;
+#endif
+
 public:
 
   cpu_test(const std::vector<std::uint8_t>& rom, std::ostream& os, std::atomic<bool>& stop)
@@ -95,34 +83,76 @@ public:
   {
     // Test ROMS start at 0x100.
     std::copy(begin(rom), end(rom), memory_.begin() + 0x100);
+    // CP/M programs give back control to the system by jumping to 0x0000, where a hlt is placed.
+    memory_[0x0000] = 0x76;
     cpu_.jump(0x100);
   }
 
   void
   memory_write_byte(std::uint16_t address, std::uint8_t value)
+  noexcept
   {
-    memory_.at(address) = value;
+    memory_[address] = value;
   }
 
   [[nodiscard]]
   std::uint8_t
   memory_read_byte(std::uint16_t address)
-  const
+  const noexcept
   {
-    return memory_.at(address);
+    return memory_[address];
+  }
+
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {memory_.data(), 0, 65536};
   }
 
   void
+  memory_write_word(std::uint16_t address, std::uint16_t value)
+  noexcept
+  {
+    if (address == 0xffff)
+    {
+      memory_[0xffff] = value & 0xff;
+      memory_[0x0000] = value >> 8;
+    }
+    else
+    {
+      cpp8080::specific::store_word(&memory_[address], value);
+    }
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  memory_read_word(std::uint16_t address)
+  const noexcept
+  {
+    if (address == 0xffff)
+    {
+      return memory_[0xffff] | (memory_[0x0000] << 8);
+    }
+    return cpp8080::specific::load_word(&memory_[address]);
+  }
+
+  // Run the program until it halts. Return false if the timeout expires first.
+  [[nodiscard]]
+  bool
   operator()()
   {
-    while (true)
+    while (not stop_)
     {
-      cpu_.step(timeout{stop_});
-      if (cpu_.pc() == 0x0000)
+      // No interrupt would wake up the cpu if it waits for one.
+      if (cpu_.run(cycles_per_run).reason == cpp8080::specific::stop_reason::halted
+          or cpu_.halted())
       {
-        break;
+        return true;
       }
     }
+    return false;
   }
 
   std::ostream&
@@ -134,6 +164,9 @@ public:
 
 private:
 
+  // Number of cycles executed between two checks of the timeout.
+  static constexpr auto cycles_per_run = std::uint64_t{1'000'000};
+
   cpp8080::specific::cpu<cpu_test> cpu_;
   std::vector<std::uint8_t> memory_;
   std::ostream& os_;
@@ -284,7 +317,10 @@ main(int argc, const char** argv)
       try
       {
         const auto checker = get_checker(rom);
-        tester();
+        if (not tester())
+        {
+          return std::make_pair(false, std::string{"Timeout"});
+        }
         return checker(oss.str());
       }
       catch (const std::exception& e)
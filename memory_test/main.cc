@@ -0,0 +1,1065 @@
+#include <algorithm>        // copy, fill_n
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>          // memcpy
+#include <initializer_list>
+#include <iostream>
+#include <memory>           // make_unique, unique_ptr
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "cpp8080/meta/instructions.hh"
+#include "cpp8080/specific/cpu.hh"
+#include "cpp8080/specific/io_bus.hh"
+#include "cpp8080/specific/memory.hh"
+#include "cpp8080/specific/memory_checkpoint.hh"
+#include "cpp8080/specific/memory_map.hh"
+#include "cpp8080/specific/scheduler.hh"
+#include "cpp8080/specific/shared_memory.hh"
+#include "cpp8080/specific/watchpoints.hh"
+
+#if CPP8080_HAS_SHARED_MEMORY
+#include <unistd.h> // getpid
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+// 64K of RAM, and 256 ports.
+class machine
+{
+public:
+
+  using overrides = cpp8080::meta::instructions<>;
+
+public:
+
+  machine()
+    : cpu_{*this}
+    , memory_(65536, 0)
+    , io_bus_{}
+  {}
+
+  void
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  noexcept
+  {
+    memory_[address] = value;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  memory_read_byte(std::uint16_t address)
+  const noexcept
+  {
+    return memory_[address];
+  }
+
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {memory_.data(), 0, 65536};
+  }
+
+  // Put bytes at address, behind the back of the cpu.
+  void
+  load(std::uint16_t address, std::initializer_list<std::uint8_t> bytes)
+  {
+    for (const auto byte : bytes)
+    {
+      memory_[address++] = byte;
+    }
+  }
+
+  cpp8080::specific::cpu<machine>&
+  cpu()
+  noexcept
+  {
+    return cpu_;
+  }
+
+  std::vector<std::uint8_t>&
+  memory()
+  noexcept
+  {
+    return memory_;
+  }
+
+  cpp8080::specific::io_bus&
+  io_bus()
+  noexcept
+  {
+    return io_bus_;
+  }
+
+private:
+
+  cpp8080::specific::cpu<machine> cpu_;
+  std::vector<std::uint8_t> memory_;
+  cpp8080::specific::io_bus io_bus_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+// 32K of RAM at 0x0000, two banks of 16K at 0x8000, switched by the machine, and a status register
+// at 0xc000, whose reads are counted. Only RAM is readable directly by the cpu.
+class banked_machine
+{
+public:
+
+  using overrides = cpp8080::meta::instructions<>;
+
+  static constexpr auto bank_first = std::uint16_t{0x8000};
+  static constexpr auto bank_last = std::uint16_t{0xbfff};
+  static constexpr auto bank_size = std::size_t{0x4000};
+
+public:
+
+  banked_machine()
+    : cpu_{*this}
+    , ram_(0x8000, 0)
+    , banks_(2 * bank_size, 0)
+    , map_{}
+    , status_{0}
+    , status_reads_{0}
+  {
+    map_.map(0x0000, 0x7fff, ram_.data());
+    map_.map_bank(bank_first, bank_last, banks_.data(), 0);
+    map_.on_read(0xc000, 0xc0ff, [this](std::uint16_t)
+    {
+      ++status_reads_;
+      return status_;
+    });
+  }
+
+  void
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  {
+    map_.write_byte(address, value);
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  memory_read_byte(std::uint16_t address)
+  const
+  {
+    return map_.read_byte(address);
+  }
+
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {ram_.data(), 0, 0x8000};
+  }
+
+  // Put bytes at address of RAM, behind the back of the cpu.
+  void
+  load(std::uint16_t address, std::initializer_list<std::uint8_t> bytes)
+  {
+    std::copy(bytes.begin(), bytes.end(), ram_.begin() + address);
+  }
+
+  // Put bytes at address of bank, behind the back of the cpu.
+  void
+  load_bank(std::size_t bank, std::uint16_t address, std::initializer_list<std::uint8_t> bytes)
+  {
+    const auto offset = bank * bank_size + (address - bank_first);
+    std::copy(bytes.begin(), bytes.end(), banks_.begin() + offset);
+  }
+
+  void
+  switch_bank(std::size_t bank)
+  {
+    map_.map_bank(bank_first, bank_last, banks_.data(), bank);
+    cpu_.remap(bank_first, bank_last);
+  }
+
+  void
+  set_status(std::uint8_t value)
+  noexcept
+  {
+    status_ = value;
+  }
+
+  [[nodiscard]]
+  std::uint64_t
+  status_reads()
+  const noexcept
+  {
+    return status_reads_;
+  }
+
+  cpp8080::specific::cpu<banked_machine>&
+  cpu()
+  noexcept
+  {
+    return cpu_;
+  }
+
+private:
+
+  cpp8080::specific::cpu<banked_machine> cpu_;
+  std::vector<std::uint8_t> ram_;
+  std::vector<std::uint8_t> banks_;
+  cpp8080::specific::memory_map map_;
+  std::uint8_t status_;
+  std::uint64_t status_reads_;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if CPP8080_HAS_WATCHPOINTS
+
+// 64K of RAM on their own host pages, so that they can be watched. Words are written by a single
+// store of the little-endian host, which faults on both pages it straddles.
+class watched_machine
+{
+public:
+
+  using overrides = cpp8080::meta::instructions<>;
+
+public:
+
+  watched_machine()
+    : cpu_{*this}
+    , memory_{std::make_unique<memory>()}
+  {}
+
+  void
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  noexcept
+  {
+    memory_->bytes[address] = value;
+  }
+
+  [[nodiscard]]
+  std::uint8_t
+  memory_read_byte(std::uint16_t address)
+  const noexcept
+  {
+    return memory_->bytes[address];
+  }
+
+  void
+  memory_write_word(std::uint16_t address, std::uint16_t value)
+  noexcept
+  {
+    if (address == 0xffff)
+    {
+      memory_->bytes[0xffff] = value & 0xff;
+      memory_->bytes[0x0000] = value >> 8;
+    }
+    else
+    {
+      std::memcpy(&memory_->bytes[address], &value, sizeof(value));
+    }
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  memory_read_word(std::uint16_t address)
+  const noexcept
+  {
+    if (address == 0xffff)
+    {
+      return memory_->bytes[0xffff] | (memory_->bytes[0x0000] << 8);
+    }
+    return cpp8080::specific::load_word(&memory_->bytes[address]);
+  }
+
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {memory_->bytes, 0, 65536};
+  }
+
+  // Put bytes at address, behind the back of the cpu.
+  void
+  load(std::uint16_t address, std::initializer_list<std::uint8_t> bytes)
+  {
+    std::copy(bytes.begin(), bytes.end(), memory_->bytes + address);
+  }
+
+  cpp8080::specific::cpu<watched_machine>&
+  cpu()
+  noexcept
+  {
+    return cpu_;
+  }
+
+  std::uint8_t*
+  host()
+  noexcept
+  {
+    return memory_->bytes;
+  }
+
+private:
+
+  struct alignas(4096) memory
+  {
+    std::uint8_t bytes[65536] = {};
+  };
+
+private:
+
+  cpp8080::specific::cpu<watched_machine> cpu_;
+  std::unique_ptr<memory> memory_;
+};
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Execute the code at address until it halts with interrupts disabled, with hooks if given.
+template <typename Cpu, typename... Hooks>
+void
+run_from(Cpu& cpu, std::uint16_t address, Hooks&&... hooks)
+{
+  cpu.jump(address);
+  while (cpu.run(1'000'000, std::forward<Hooks>(hooks)...).reason
+         != cpp8080::specific::stop_reason::halted)
+  {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Hooks which make run() interpret instructions one by one from memory, rather than executing
+// decoded blocks and traces.
+struct interpreted
+{
+  template <typename Cpu, typename Instruction>
+  void pre(const Cpu&, Instruction) const noexcept
+  {}
+
+  template <typename Cpu, typename Instruction>
+  void post(const Cpu&, Instruction) const noexcept
+  {}
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+static auto failures = 0;
+
+static void
+check(bool condition, const char* what)
+{
+  if (not condition)
+  {
+    std::cerr << "FAILED: " << what << '\n';
+    ++failures;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Take checkpoints between writes, rewind to each of them and compare memory.
+void
+test_checkpoints()
+{
+  using cpp8080::specific::memory_checkpoint;
+
+  auto m = machine{};
+  auto& cpu = m.cpu();
+  m.load(0x0100, {0x3e, 0x01, 0x76}); // mvi a,1; hlt
+  run_from(cpu, 0x0100);
+
+  const auto c0 = memory_checkpoint::take(cpu);
+  check(c0.size() == 65536, "first checkpoint holds the whole memory");
+  const auto s0 = m.memory();
+
+  cpu.memory_write_byte(0x0101, 0x02);
+  cpu.memory_write_byte(0x2000, 0x11);
+  cpu.memory_write_byte(0x21ff, 0x12);
+  cpu.memory_write_byte(0x9000, 0x13);
+  const auto c1 = memory_checkpoint::take(cpu);
+  check(c1.pages() == std::vector<std::uint8_t>{0x01, 0x20, 0x21, 0x90}, "written pages");
+  const auto s1 = m.memory();
+  run_from(cpu, 0x0100);
+  check(cpu.a() == 2, "modified code executed");
+
+  cpu.memory_write_byte(0x0101, 0x03);
+  cpu.memory_write_byte(0x2000, 0x21);
+  cpu.memory_write_byte(0x3000, 0x22);
+  const auto c2 = memory_checkpoint::take(cpu);
+  check(c2.pages() == std::vector<std::uint8_t>{0x01, 0x20, 0x30}, "pages written again");
+  run_from(cpu, 0x0100);
+  check(cpu.a() == 3, "code modified again executed");
+
+  // Writes since the last checkpoint are rewound too.
+  cpu.memory_write_byte(0x4000, 0x31);
+
+  c0.restore(cpu, m.memory().data(), 0, 65536);
+  c1.restore(cpu, m.memory().data(), 0, 65536);
+  check(m.memory() == s1, "memory rewound to the second checkpoint");
+  check(memory_checkpoint::take(cpu).size() == 0, "restored pages are not dirty");
+  run_from(cpu, 0x0100);
+  check(cpu.a() == 2, "restored code executed");
+
+  c0.restore(cpu, m.memory().data(), 0, 65536);
+  check(m.memory() == s0, "memory rewound to the first checkpoint");
+  run_from(cpu, 0x0100);
+  check(cpu.a() == 1, "first code executed");
+
+  // Pages outside of host memory are left alone.
+  cpu.memory_write_byte(0x0101, 0x04);
+  cpu.memory_write_byte(0x9000, 0x41);
+  const auto c3 = memory_checkpoint::take(cpu);
+  cpu.memory_write_byte(0x0101, 0x05);
+  cpu.memory_write_byte(0x9000, 0x51);
+  c3.restore(cpu, m.memory().data(), 0, 0x8000);
+  check(m.memory()[0x0101] == 0x04, "page inside host memory restored");
+  check(m.memory()[0x9000] == 0x51, "page outside host memory skipped");
+  check(cpu.dirty_pages().count() == 1 and cpu.dirty_pages()[0x90], "skipped page still dirty");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Write into the middle of fused sequences of decoded code, and compare each run with a copy of the
+// machine which interprets the code.
+void
+test_fusions()
+{
+  auto fused = machine{};
+  auto reference = machine{};
+  for (auto m : {&fused, &reference})
+  {
+    m->load(0x0100, {0x21, 0x00, 0x20,  // lxi h,0x2000
+                     0x7e,              // mov a,m
+                     0x06, 0x03,        // mvi b,3
+                     0x77,              // loop: mov m,a
+                     0x23,              // inx h
+                     0x3c,              // inr a
+                     0x05,              // dcr b
+                     0xc2, 0x06, 0x01,  // jnz loop
+                     0x3a, 0x00, 0x20,  // lda 0x2000
+                     0xa7,              // ana a
+                     0xc2, 0x16, 0x01,  // jnz done
+                     0x0e, 0x01,        // mvi c,1
+                     0x76});            // done: hlt
+    m->load(0x2000, {0x05});
+  }
+  const auto same = [&]
+  {
+    const auto& c1 = fused.cpu();
+    const auto& c2 = reference.cpu();
+    return c1.a() == c2.a() and c1.bc() == c2.bc() and c1.hl() == c2.hl()
+       and c1.psw() == c2.psw() and c1.pc() == c2.pc() and c1.cycles() == c2.cycles()
+       and fused.memory() == reference.memory();
+  };
+  const auto run = [&]
+  {
+    for (auto i = 0; i < 20; ++i)
+    {
+      run_from(fused.cpu(), 0x0100);
+      run_from(reference.cpu(), 0x0100, interpreted{});
+    }
+  };
+
+  run();
+  check(fused.cpu().decoded(0x0100), "code decoded");
+  check(same(), "fused code executed as interpreted code");
+
+  const auto writes = std::vector<std::pair<std::uint16_t, std::uint8_t>>{
+    {0x0103, 0x4e}, // mov c,m
+    {0x0109, 0x0d}, // dcr c
+    {0x0110, 0xb7}  // ora a
+  };
+  for (const auto& [address, opcode] : writes)
+  {
+    check(fused.cpu().decoded(address), "code of the fused sequence decoded");
+    fused.cpu().memory_write_byte(address, opcode);
+    reference.cpu().memory_write_byte(address, opcode);
+    check(not fused.cpu().decoded(address), "fused sequence dropped");
+    run();
+    check(same(), "modified code executed as interpreted code");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Write bytes and words, some of them across pages, to ROM whose writes are discarded or counted,
+// to RAM, and to a handler.
+void
+test_memory_map()
+{
+  auto rom = std::vector<std::uint8_t>(0x200, 0xaa);
+  auto ram = std::vector<std::uint8_t>(0x100, 0x00);
+  auto written = std::vector<std::pair<std::uint16_t, std::uint8_t>>{};
+  auto map = cpp8080::specific::memory_map{};
+  map.map_read(0x0000, 0x01ff, rom.data());
+  map.discard_writes(0x0000, 0x00ff);
+  map.count_writes(0x0100, 0x01ff);
+  map.map(0x0200, 0x02ff, ram.data());
+  map.on_write(0x0300, 0x03ff, [&](std::uint16_t address, std::uint8_t value)
+  {
+    written.emplace_back(address, value);
+  });
+
+  map.write_byte(0x0010, 0x01);
+  map.write_word(0x0020, 0x0203);
+  check(map.read_byte(0x0010) == 0xaa and map.read_word(0x0020) == 0xaaaa, "discarded writes");
+  check(map.discarded_writes() == 0, "discarded writes not counted");
+
+  map.write_byte(0x0110, 0x04);
+  map.write_word(0x0120, 0x0506);
+  check(map.discarded_writes() == 3, "counted writes");
+  map.write_word(0x01ff, 0x0708);
+  check(map.discarded_writes() == 4 and ram[0x00] == 0x07, "word across counted ROM and RAM");
+  check(std::all_of(rom.begin(), rom.end(), [](auto byte){return byte == 0xaa;}),
+        "ROM unchanged");
+
+  map.write_byte(0x0305, 0x09);
+  map.write_word(0x03fe, 0x0a0b);
+  map.write_word(0x02ff, 0x0c0d);
+  const auto expected = decltype(written){{0x0305, 0x09}, {0x03fe, 0x0b}, {0x03ff, 0x0a},
+                                         {0x0300, 0x0c}};
+  check(written == expected, "addresses and values given to the write handler");
+  check(ram[0xff] == 0x0d, "word across RAM and a write handler");
+  check(map.read_byte(0x0400) == 0xff, "unmapped page");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Switch banks under code which has been decoded, and hot enough to be traced.
+void
+test_banks()
+{
+  auto m = banked_machine{};
+  auto& cpu = m.cpu();
+  m.load(0x0100, {0x06, 0x07, 0x76});                         // mvi b,7; hlt
+  m.load(0x0200, {0x31, 0x00, 0x70, 0xcd, 0x00, 0x80, 0x76}); // lxi sp,0x7000; call 0x8000; hlt
+  m.load_bank(0, 0x8000, {0x3e, 0x01, 0xc9});                 // mvi a,1; ret
+  m.load_bank(1, 0x8000, {0x3e, 0x02, 0xc9});                 // mvi a,2; ret
+
+  for (auto i = 0; i < 20; ++i)
+  {
+    run_from(cpu, 0x0100);
+    run_from(cpu, 0x0200);
+  }
+  check(cpu.a() == 1, "first bank executed");
+  check(cpu.decoded(0x0100) and cpu.decoded(0x8000), "code decoded");
+
+  m.switch_bank(1);
+  check(cpu.decoded(0x0100), "code outside of the bank kept");
+  check(not cpu.decoded(0x8000), "code of the bank dropped");
+  for (auto i = 0; i < 20; ++i)
+  {
+    run_from(cpu, 0x0200);
+    check(cpu.a() == 2, "second bank executed");
+    run_from(cpu, 0x0100);
+    check(cpu.bc() >> 8 == 7, "code outside of the bank executed");
+  }
+
+  m.switch_bank(0);
+  run_from(cpu, 0x0200);
+  check(cpu.a() == 1, "first bank executed again");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A program polling a byte of RAM until the machine or an interrupt handler writes it, and a copy
+// which is interpreted instruction by instruction. Skipped iterations must leave the cpu in the
+// same state as interpreted ones, at the same cycle.
+class polling_machines
+{
+public:
+
+  explicit
+  polling_machines(std::uint16_t start)
+  {
+    for (auto m : {&skipped, &reference})
+    {
+      m->load(0x0008, {0x3e, 0x01,         // mvi a,1
+                       0x32, 0x00, 0x20,   // sta 0x2000
+                       0xc9});             // ret
+      m->load(0x0100, {0x31, 0x00, 0x70,   // lxi sp,0x7000
+                       0x3a, 0x00, 0x20,   // loop: lda 0x2000
+                       0xa7,               // ana a
+                       0xca, 0x03, 0x01,   // jz loop
+                       0x76});             // hlt
+      m->load(0x0200, {0xfb,               // ei
+                       0xc3, 0x00, 0x01}); // jmp 0x0100
+      m->cpu().jump(start);
+    }
+  }
+
+  // Run both machines for budget cycles. Return the stop reason of the skipping one.
+  cpp8080::specific::stop_reason
+  run(std::uint64_t budget)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    const auto reason = skipped.cpu().run(budget).reason;
+    const auto middle = std::chrono::steady_clock::now();
+    reference.cpu().run(budget, interpreted{});
+    skipped_time += middle - start;
+    reference_time += std::chrono::steady_clock::now() - middle;
+    return reason;
+  }
+
+  [[nodiscard]]
+  bool
+  same()
+  {
+    return skipped.cpu().cycles() == reference.cpu().cycles()
+       and skipped.cpu().pc() == reference.cpu().pc()
+       and skipped.cpu().a() == reference.cpu().a();
+  }
+
+  machine skipped;
+  machine reference;
+  std::chrono::steady_clock::duration skipped_time{};
+  std::chrono::steady_clock::duration reference_time{};
+};
+
+// Skip the iterations of loops polling RAM, but not those of loops polling a status register.
+void
+test_idle_loops()
+{
+  using cpp8080::specific::stop_reason;
+
+  auto written = polling_machines{0x0100};
+  for (const auto budget : {1'000, 4'095, 100'000, 12'345'677, 50'000'000})
+  {
+    written.run(budget);
+    check(written.same(), "exact cycles of skipped iterations");
+  }
+  check(written.skipped_time * 10 < written.reference_time, "iterations skipped");
+  written.skipped.load(0x2000, {0x01});
+  written.reference.load(0x2000, {0x01});
+  check(written.run(1'000'000) == stop_reason::halted, "loop ended by a write");
+  check(written.same(), "exact cycles after a write");
+
+  auto interrupted = polling_machines{0x0200};
+  interrupted.run(10'000'000);
+  interrupted.skipped.cpu().raise_interrupt(1);
+  interrupted.reference.cpu().raise_interrupt(1);
+  check(interrupted.run(1'000'000) == stop_reason::halted, "loop ended by an interrupt");
+  check(interrupted.skipped.cpu().a() == 1 and interrupted.same(),
+        "exact cycles after an interrupt");
+
+  // The status register is outside of readable memory: each iteration must read it.
+  auto m = banked_machine{};
+  m.load(0x0100, {0x3a, 0x00, 0xc0,  // loop: lda 0xc000
+                  0xa7,              // ana a
+                  0xca, 0x00, 0x01,  // jz loop
+                  0x76});            // hlt
+  m.cpu().jump(0x0100);
+  const auto cycles = m.cpu().run(1'000'000).cycles;
+  check(m.status_reads() >= cycles / 27, "loop reading outside of readable memory not skipped");
+  m.set_status(1);
+  check(m.cpu().run(1'000'000).reason == stop_reason::halted, "loop ended by the status register");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Raise interrupts around ei and di. The handler of RST 1 saves B and C into D and E.
+void
+test_interrupts()
+{
+  using cpp8080::specific::stop_reason;
+
+  const auto load = [](machine& m)
+  {
+    m.load(0x0008, {0x50,              // mov d,b
+                    0x59,              // mov e,c
+                    0xc9});            // ret
+    m.load(0x0100, {0x31, 0x00, 0x70,  // lxi sp,0x7000
+                    0xfb,              // ei
+                    0x06, 0x01,        // mvi b,1
+                    0x0e, 0x02,        // mvi c,2
+                    0x76,              // hlt
+                    0x76});            // hlt
+    m.load(0x0200, {0x31, 0x00, 0x70,  // lxi sp,0x7000
+                    0xfb,              // ei
+                    0xf3,              // di
+                    0x06, 0x01,        // mvi b,1
+                    0xfb,              // ei
+                    0x0e, 0x02,        // mvi c,2
+                    0x76});            // hlt
+  };
+
+  {
+    auto m = machine{};
+    load(m);
+    auto& cpu = m.cpu();
+    cpu.jump(0x0100);
+    cpu.step();
+    cpu.step();
+    cpu.raise_interrupt(1);
+    cpu.step();
+    check(cpu.pc() == 0x0106, "instruction following ei executed by step");
+    cpu.step();
+    check(cpu.pc() == 0x0008, "interrupt accepted by step after the instruction following ei");
+  }
+  {
+    auto m = machine{};
+    load(m);
+    auto& cpu = m.cpu();
+    cpu.jump(0x0100);
+    cpu.step();
+    cpu.step();
+    cpu.raise_interrupt(1);
+    check(cpu.run(1'000).reason == stop_reason::halted, "halted after the interrupt");
+    check(cpu.de() == 0x0100, "interrupt accepted by run after the instruction following ei");
+  }
+  {
+    auto m = machine{};
+    load(m);
+    auto& cpu = m.cpu();
+    cpu.jump(0x0200);
+    cpu.step();
+    cpu.step();
+    cpu.raise_interrupt(1);
+    check(cpu.run(1'000).reason == stop_reason::halted, "halted after the latched interrupt");
+    check(cpu.de() == 0x0102, "request latched across di accepted after the next ei");
+  }
+  {
+    auto m = machine{};
+    load(m);
+    auto& cpu = m.cpu();
+    cpu.raise_interrupt(1);
+    cpu.lower_interrupt(1);
+    cpu.jump(0x0100);
+    check(cpu.run(1'000).reason == stop_reason::budget and cpu.halted(), "waiting after hlt");
+    check(cpu.de() == 0x0000, "lowered request not accepted");
+    cpu.raise_interrupt(1);
+    check(cpu.run(1'000).reason == stop_reason::halted, "halted after the raised interrupt");
+    check(cpu.de() == 0x0102, "raised request accepted after hlt");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Wait for an interrupt after hlt, then resume after it.
+void
+test_halt()
+{
+  using cpp8080::specific::stop_reason;
+
+  auto m = machine{};
+  auto& cpu = m.cpu();
+  m.load(0x0010, {0x0e, 0x02,        // mvi c,2
+                  0xc9});            // ret
+  m.load(0x0100, {0x31, 0x00, 0x70,  // lxi sp,0x7000
+                  0xfb,              // ei
+                  0x76,              // hlt
+                  0x06, 0x01,        // mvi b,1
+                  0x76});            // hlt
+  cpu.jump(0x0100);
+
+  const auto first = cpu.run(1'000);
+  check(first.reason == stop_reason::budget and first.cycles == 1'000, "budget used up by hlt");
+  check(cpu.halted() and cpu.pc() == 0x0105, "waiting for an interrupt after hlt");
+  const auto second = cpu.run(123'457);
+  check(second.reason == stop_reason::budget and second.cycles == 123'457,
+        "whole budget used up while waiting");
+  const auto step = cpu.step();
+  check(step.cycles == 4 and cpu.cycles() == 124'461, "time of a nop passed by step");
+  check(cpu.halted() and cpu.bc() == 0x0000, "still waiting");
+
+  cpu.raise_interrupt(2);
+  const auto third = cpu.run(1'000);
+  check(third.reason == stop_reason::halted and third.cycles < 1'000,
+        "stopped by hlt with interrupts disabled");
+  check(not cpu.halted() and cpu.bc() == 0x0102 and cpu.pc() == 0x0108,
+        "resumed after hlt once the interrupt has been handled");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Execute in and out on latched, handled and unmapped ports.
+void
+test_io_bus()
+{
+  auto m = machine{};
+  auto& bus = m.io_bus();
+  auto latch = std::uint8_t{0};
+  auto input = std::uint8_t{0x5a};
+  auto output = std::uint8_t{0};
+  auto written = std::vector<std::pair<std::uint8_t, std::uint8_t>>{};
+  bus.latch(0x10, &latch);
+  bus.latch_in(0x11, &input);
+  bus.latch_out(0x12, &output);
+  bus.on_in(0x20, [](std::uint8_t port){return static_cast<std::uint8_t>(port + 1);});
+  bus.on_out(0x21, [&](std::uint8_t port, std::uint8_t value){written.emplace_back(port, value);});
+  bus.on_out(0x22, [&](std::uint8_t port, std::uint8_t value){written.emplace_back(port, value);});
+  bus.ignore_out(0x22);
+  m.load(0x0100, {0x3e, 0x42,        // mvi a,0x42
+                  0xd3, 0x10,        // out 0x10
+                  0x3e, 0x00,        // mvi a,0
+                  0xdb, 0x10,        // in 0x10
+                  0x32, 0x00, 0x20,  // sta 0x2000
+                  0xdb, 0x11,        // in 0x11
+                  0x32, 0x01, 0x20,  // sta 0x2001
+                  0xd3, 0x11,        // out 0x11
+                  0xd3, 0x12,        // out 0x12
+                  0xdb, 0x20,        // in 0x20
+                  0x32, 0x02, 0x20,  // sta 0x2002
+                  0xd3, 0x21,        // out 0x21
+                  0xd3, 0x22,        // out 0x22
+                  0xdb, 0x30,        // in 0x30
+                  0x32, 0x03, 0x20,  // sta 0x2003
+                  0x76});            // hlt
+  run_from(m.cpu(), 0x0100);
+  const auto& memory = m.memory();
+  check(latch == 0x42 and memory[0x2000] == 0x42, "latched port written and read back");
+  check(memory[0x2001] == 0x5a and input == 0x5a, "input latch read, and not written");
+  check(output == 0x5a, "output latch written");
+  check(memory[0x2002] == 0x21, "handled port read");
+  check(written == decltype(written){{0x21, 0x21}}, "handled port written, ignored one not");
+  check(memory[0x2003] == 0xff, "unmapped port read as 0xff");
+
+  bus.unmapped_input(0x00);
+  m.load(0x0200, {0xdb, 0x30,        // in 0x30
+                  0x32, 0x04, 0x20,  // sta 0x2004
+                  0x76});            // hlt
+  run_from(m.cpu(), 0x0200);
+  check(memory[0x2004] == 0x00, "unmapped port read as the given value");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// A callback which counts the copies made of it.
+struct counted_callback
+{
+  std::shared_ptr<int> copies;
+
+  explicit
+  counted_callback(std::shared_ptr<int> c)
+    : copies{std::move(c)}
+  {}
+
+  counted_callback(const counted_callback& other)
+    : copies{other.copies}
+  {
+    ++*copies;
+  }
+
+  counted_callback(counted_callback&&) = default;
+
+  void
+  operator()()
+  const noexcept
+  {}
+};
+
+// Fire events while a cpu executes nops, of 4 cycles each.
+void
+test_scheduler()
+{
+  using cpp8080::specific::scheduler;
+
+  auto m = machine{};
+  auto& cpu = m.cpu();
+  auto s = scheduler{};
+  auto fired = std::vector<std::pair<char, std::uint64_t>>{};
+  const auto record = [&](char name)
+  {
+    return [&fired, &cpu, name]{fired.emplace_back(name, cpu.cycles());};
+  };
+
+  s.at(102, record('a'));
+  s.at(102, record('b'));
+  s.after(102, record('c'));
+  s.at(50, record('d'));
+  const auto cancelled = s.at(102, record('e'));
+  s.at(10'005, record('f'));
+  check(s.cancel(cancelled), "event cancelled");
+  check(not s.cancel(cancelled), "event cancelled once");
+  const auto result = s.run_until(cpu, 10'001);
+  check(result.cycles == 10'004 and cpu.cycles() == 10'004 and s.now() == 10'004,
+        "run until the first instruction boundary after the cycle");
+  check(fired == decltype(fired){{'d', 52}, {'a', 104}, {'b', 104}, {'c', 104}},
+        "events fired in order, at the end of the instruction reaching their cycle");
+  check(s.next() == 10'005, "later event kept");
+
+  // Periodic events are dated from the cycle of their previous occurrence, not from the cycle the
+  // cpu has reached.
+  const auto start = cpu.cycles();
+  auto p = std::vector<std::uint64_t>{};
+  auto q = std::vector<std::uint64_t>{};
+  auto periodic = scheduler::event_id{};
+  periodic = s.every(1'002, [&]
+  {
+    p.push_back(cpu.cycles());
+    if (p.size() == 3)
+    {
+      check(s.cancel(periodic), "periodic event cancelled by itself");
+    }
+  });
+  s.every(1'002, 501, [&]{q.push_back(cpu.cycles());});
+  const auto copies = std::make_shared<int>(0);
+  s.every(100, counted_callback{copies});
+  *copies = 0;
+  s.run(cpu, 10'000);
+  const auto boundary = [](std::uint64_t cycle){return (cycle + 3) / 4 * 4;};
+  auto expected_p = std::vector<std::uint64_t>{};
+  for (auto i = std::uint64_t{1}; i <= 3; ++i)
+  {
+    expected_p.push_back(boundary(start + i * 1'002));
+  }
+  auto expected_q = std::vector<std::uint64_t>{};
+  for (auto cycle = start + 501; cycle <= start + 10'000; cycle += 1'002)
+  {
+    expected_q.push_back(boundary(cycle));
+  }
+  check(p == expected_p, "periodic event fired until cancelled");
+  check(q == expected_q, "periodic event without drift");
+  check(*copies == 0, "callbacks of periodic events moved, not copied");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if CPP8080_HAS_WATCHPOINTS
+
+// Watch addresses written by a program, by bytes and by words, one of them straddling two host
+// pages.
+void
+test_watchpoints()
+{
+  auto m = watched_machine{};
+  auto& cpu = m.cpu();
+  m.load(0x0100, {0x3e, 0x42,        // mvi a,0x42
+                  0x32, 0x00, 0x90,  // sta 0x9000
+                  0x32, 0x01, 0x90,  // sta 0x9001
+                  0x21, 0x34, 0x12,  // lxi h,0x1234
+                  0x22, 0xff, 0x9f,  // shld 0x9fff
+                  0x32, 0x00, 0xa0,  // sta 0xa000
+                  0x22, 0x10, 0x90,  // shld 0x9010
+                  0x76});            // hlt
+
+  auto hits = std::vector<cpp8080::specific::watchpoint_hit>{};
+  {
+    auto watchpoints = cpp8080::specific::watchpoints{cpu, m.host(), 0, 65536};
+    watchpoints.watch(0x9000);
+    watchpoints.watch(0x9011);
+    watchpoints.watch(0xa000);
+    run_from(cpu, 0x0100);
+    const auto dropped = watchpoints.report([&](const auto& hit){hits.push_back(hit);});
+    check(dropped == 0, "no dropped hits");
+  }
+
+  const auto hit = [&](std::size_t i, std::uint16_t pc, std::uint16_t address,
+                       std::uint8_t old_value, std::uint8_t value)
+  {
+    return i < hits.size() and hits[i].pc == pc and hits[i].address == address
+       and hits[i].old_value == old_value and hits[i].value == value;
+  };
+  check(hits.size() == 4, "hits of watched addresses only");
+  check(hit(0, 0x0105, 0x9000, 0x00, 0x42), "hit of sta");
+  check(hit(1, 0x010e, 0xa000, 0x00, 0x12), "hit of shld straddling two pages");
+  check(hit(2, 0x0111, 0xa000, 0x12, 0x42), "hit of sta after both pages are watched again");
+  check(hit(3, 0x0114, 0x9011, 0x00, 0x12), "hit of the high byte of shld");
+  check(m.host()[0x9001] == 0x42, "write to an unwatched address of a watched page");
+  check(m.host()[0x9fff] == 0x34 and m.host()[0xa000] == 0x42, "straddling write");
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+#if CPP8080_HAS_SHARED_MEMORY
+
+// Export memory and sample it, while it's written and between two writes.
+void
+test_shared_memory()
+{
+  using cpp8080::specific::shared_memory;
+  using cpp8080::specific::shared_memory_reader;
+
+  const auto name = "/cpp8080_memory_test_" + std::to_string(::getpid());
+  auto writer = shared_memory{name};
+  const auto reader = shared_memory_reader{name};
+  std::uint8_t sample[2];
+
+  writer.begin_write();
+  std::fill_n(writer.memory() + 0x2000, 256, std::uint8_t{1});
+  writer.memory()[0x2400] = 0x5a;
+  writer.memory()[0x2401] = 0xa5;
+  check(not reader.sample(0x2400, 2, sample, 10), "no sample while memory is written");
+  writer.end_write();
+  check(reader.sample(0x2400, 2, sample) == 1u, "sample of the first frame");
+  check(sample[0] == 0x5a and sample[1] == 0xa5, "sampled memory");
+  check(reader.memory()[0x2401] == 0xa5, "read memory");
+
+  // Frames fill a page with their number, and samples must never mix two of them.
+  auto mixed = false;
+  auto sampled = 0;
+  auto thread = std::thread{[&]
+  {
+    std::uint8_t page[256];
+    for (auto i = 0; i < 1000; ++i)
+    {
+      if (const auto frame = reader.sample(0x2000, sizeof(page), page); frame)
+      {
+        ++sampled;
+        for (const auto byte : page)
+        {
+          mixed = mixed or byte != static_cast<std::uint8_t>(*frame);
+        }
+      }
+    }
+  }};
+  for (auto frame = std::uint64_t{2}; frame < 100'000; ++frame)
+  {
+    writer.begin_write();
+    std::fill_n(writer.memory() + 0x2000, 256, static_cast<std::uint8_t>(frame));
+    writer.end_write();
+  }
+  thread.join();
+  check(not mixed, "consistent samples");
+  check(sampled != 0, "samples while memory is written");
+
+  auto missing = false;
+  try
+  {
+    const auto unknown = shared_memory_reader{name + "_unknown"};
+  }
+  catch (const std::system_error&)
+  {
+    missing = true;
+  }
+  check(missing, "missing segment");
+}
+
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main()
+{
+  test_checkpoints();
+  test_memory_map();
+  test_fusions();
+  test_banks();
+  test_idle_loops();
+  test_interrupts();
+  test_halt();
+  test_io_bus();
+  test_scheduler();
+#if CPP8080_HAS_WATCHPOINTS
+  test_watchpoints();
+#endif
+#if CPP8080_HAS_SHARED_MEMORY
+  test_shared_memory();
+#endif
+
+  if (failures != 0)
+  {
+    return 1;
+  }
+  std::cout << "All tests succeeded.\n";
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <cstdint>
 #include <utility> // pair
-#include <vector>
 
 #include "events.hh"
 
@@ -18,9 +18,10 @@ public:
   std::pair<kind, event>
   get_next_event()= 0;
 
+  // memory holds the 16 KiB of ROM and RAM of the machine.
   virtual
   void
-  render_screen(const std::vector<std::uint8_t>&) = 0;
+  render_screen(const std::uint8_t* memory) = 0;
 };
 
 /*------------------------------------------------------------------------------------------------*/
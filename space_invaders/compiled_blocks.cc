@@ -0,0 +1,13 @@
+#include "space_invaders.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::vector<cpp8080::meta::compiled_block<cpp8080::specific::cpu<space_invaders>>>&
+space_invaders_compiled_blocks()
+{
+  static const auto blocks =
+    std::vector<cpp8080::meta::compiled_block<cpp8080::specific::cpu<space_invaders>>>{};
+  return blocks;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -13,9 +13,9 @@
 int
 main(int argc, const char** argv)
 {
-  if (argc != 2)
+  if (argc != 2 and argc != 3)
   {
-    std::cerr << "Usage: " << argv[0] << " /path/to/file\n";
+    std::cerr << "Usage: " << argv[0] << " /path/to/file [shared memory name]\n";
     return 1;
   }
 
@@ -29,7 +29,8 @@ main(int argc, const char** argv)
   auto machine = space_invaders{
     std::unique_ptr<arcade>{new sdl{}},
     std::istreambuf_iterator<char>{file},
-    std::istreambuf_iterator<char>{}
+    std::istreambuf_iterator<char>{},
+    argc == 3 ? argv[2] : ""
   };
 
   machine();
@@ -105,7 +105,7 @@ sdl::get_next_event()
 /*------------------------------------------------------------------------------------------------*/
 
 void
-sdl::render_screen(const std::vector<std::uint8_t>& vram)
+sdl::render_screen(const std::uint8_t* vram)
 {
   //  Screen is rotated 90° counterclockwise, we can't simply iterate on video memory.
   //  Rather than computing the rotation, I chose to iterate in such a way that pixels
@@ -150,7 +150,7 @@ sdl::render_screen(const std::vector<std::uint8_t>& vram)
   {
     for (auto i = 0, x = 0; i < 224; ++i, ++x)
     {
-      const auto byte = vram.at(0x2400 + (j  + i * 32));
+      const auto byte = vram[0x2400 + (j  + i * 32)];
       for (auto b = 7, pos = 0; b >= 0; --b, ++pos)
       {
         if (((byte >> b) & 0x01) == 1)
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <utility> // pair
-#include <vector>
 
 #include <SDL2/SDL.h>
 
@@ -24,7 +23,7 @@ public:
   override;
 
   void
-  render_screen(const std::vector<std::uint8_t>&)
+  render_screen(const std::uint8_t*)
   override;
 
 private:
@@ -1,6 +1,6 @@
 #include <algorithm>
 #include <chrono>
-#include <sstream>
+#include <iostream>
 #include <thread>
 
 #include "space_invaders.hh"
@@ -13,120 +13,38 @@ static constexpr auto cycles_per_frame = cycles_per_second / fps;
 
 /*------------------------------------------------------------------------------------------------*/
 
-[[nodiscard]]
-std::uint8_t
-space_invaders::in(std::uint8_t port)
-const
-{
-  switch (port)
-  {
-    case 1:
-      return port1_;
-
-    case 2:
-      return port2_;
-
-    case 3:
-    {
-      const std::uint16_t v = (shift1_ << 8) | shift0_;
-      return (v >> (8 - shift_offset_)) & 0xff;
-    }
-
-    default:
-      throw std::runtime_error{"Unknwown IN port"};
-  }
-}
-
-/*------------------------------------------------------------------------------------------------*/
-
-void
-space_invaders::out(std::uint8_t port, std::uint8_t value)
-{
-  switch (port)
-  {
-    case 2:
-      shift_offset_ = value & 0x07;
-      break;
-
-    case 3:
-      // play sound;
-      break;
-
-    case 4:
-      shift0_ = shift1_;
-      shift1_ = value;
-      break;
-
-    case 5:
-      // play sound;
-      break;
-
-    case 6:
-      break;
-
-    default:
-      throw std::runtime_error{"Unknwown OUT port"};
-  }
-}
-
-/*------------------------------------------------------------------------------------------------*/
-
-void
-space_invaders::memory_write_byte(std::uint16_t address, std::uint8_t value)
-{
-  if (address < 0x2000)
-  {
-    auto ss = std::stringstream{};
-    ss << std::hex << "Attempt to write 0x" << +value << " in ROM at 0x" << +address;
-    throw std::runtime_error{ss.str()};
-  }
-
-  if (address >= 0x4000)
-  {
-    // Mirror RAM. What's the goal of this?
-    return; // address -= 0x2000 also works;
-  }
-
-  memory_[address] = value;
-}
-
-/*------------------------------------------------------------------------------------------------*/
-
-[[nodiscard]]
-std::uint8_t
-space_invaders::memory_read_byte(std::uint16_t address)
-const
-{
-  return memory_.at(address);
-}
-
-/*------------------------------------------------------------------------------------------------*/
-
 void
 space_invaders::operator()()
 {
+  // Mid-screen and end of screen interrupts.
+  scheduler_.every(cycles_per_frame, cycles_per_frame / 2, [this]{cpu_.raise_interrupt(1);});
+  scheduler_.every(cycles_per_frame, [this]{cpu_.raise_interrupt(2);});
+
   arcade_->render_screen(memory_);
-  auto next_interrupt = std::uint16_t{0x08};
+  auto rom_writes = memory_map_.discarded_writes();
+  auto frame_end = cpu_.cycles();
 
   while (process_events())
   {
     const auto now = std::chrono::high_resolution_clock::now();
-    for (auto counter = 0ul, total_cycles = 0ul; total_cycles < cycles_per_frame;)
+    if (shared_memory_)
     {
-      const auto cycles = cpu_.step();
-
-      counter += cycles;
-      total_cycles += cycles;
-
-      if (counter >= (cycles_per_frame / 2))
-      {
-        counter -= (cycles_per_frame / 2);
-        cpu_.interrupt(next_interrupt);
-        next_interrupt = next_interrupt == 0x08 ? 0x10 : 0x08;
-      }
+      shared_memory_->begin_write();
+    }
+    frame_end += cycles_per_frame;
+    scheduler_.run_until(cpu_, frame_end);
+    if (shared_memory_)
+    {
+      shared_memory_->end_write();
     }
     arcade_->render_screen(memory_);
 
+    if (const auto writes = memory_map_.discarded_writes(); writes != rom_writes)
+    {
+      std::cerr << "Ignored " << writes - rom_writes << " write(s) to ROM\n";
+      rom_writes = writes;
+    }
+
     const auto duration = std::chrono::high_resolution_clock::now() - now;
     // A frame lasts 1/60s.
     std::this_thread::sleep_for(std::chrono::microseconds{16666} - duration);
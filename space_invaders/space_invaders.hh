@@ -2,80 +2,135 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "cpp8080/meta/instructions.hh"
 #include "cpp8080/specific/cpu.hh"
+#include "cpp8080/specific/io_bus.hh"
+#include "cpp8080/specific/memory_map.hh"
+#include "cpp8080/specific/scheduler.hh"
+#include "cpp8080/specific/shared_memory.hh"
 
 #include "arcade.hh"
 #include "events.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
-class space_invaders
-{
-private:
+class space_invaders;
 
-  struct in_override : cpp8080::meta::describe_instruction<0xdb, 3, 2>
-  {
-    static constexpr auto name = "in";
+// Blocks of the ROM compiled ahead of time by cpp8080_aot. Empty, unless the executable is linked
+// with the generated code instead of compiled_blocks.cc.
+const std::vector<cpp8080::meta::compiled_block<cpp8080::specific::cpu<space_invaders>>>&
+space_invaders_compiled_blocks();
 
-    void operator()(cpp8080::specific::cpu<space_invaders>& cpu) const
-    {
-      const auto port = cpu.op1();
-      cpu.a() = cpu.machine().in(port);
-    }
-  };
-
-  struct out_override : cpp8080::meta::describe_instruction<0xd3, 3, 2>
-  {
-    static constexpr auto name = "out";
-
-    void operator()(cpp8080::specific::cpu<space_invaders>& cpu) const
-    {
-      const auto port = cpu.op1();
-      cpu.machine().out(port, cpu.a());
-    }
-  };
+/*------------------------------------------------------------------------------------------------*/
 
+class space_invaders
+{
 public:
 
-  using overrides = cpp8080::meta::make_instructions<
-    in_override,
-    out_override
-  >;
+  using overrides = cpp8080::meta::instructions<>;
 
 public:
 
+  // Memory is exported in the POSIX shared memory segment named shared_memory_name, if any.
   template <typename InputIterator>
-  space_invaders(std::unique_ptr<arcade>&& arcade, InputIterator first, InputIterator last)
+  space_invaders(std::unique_ptr<arcade>&& arcade, InputIterator first, InputIterator last,
+                 const std::string& shared_memory_name = {})
     : arcade_{std::move(arcade)}
     , cpu_{*this}
-    , memory_(16384, 0)
+    , shared_memory_{shared_memory_name.empty()
+                     ? nullptr
+                     : std::make_unique<cpp8080::specific::shared_memory>(shared_memory_name)}
+    , local_memory_(shared_memory_ ? 0 : memory_size, 0)
+    , memory_{shared_memory_ ? shared_memory_->memory() : local_memory_.data()}
+    , memory_map_{}
+    , io_bus_{}
+    , scheduler_{}
     , shift0_{0}
     , shift1_{0}
     , shift_offset_{0}
     , port1_{1 << 3}
     , port2_{0}
   {
-    std::copy(first, last, memory_.begin());
+    std::copy(first, last, memory_);
+
+    // 8 KiB of ROM, followed by 8 KiB of RAM, mirrored up to the end of the address space. Writes
+    // to ROM are counted and ignored, writes to the mirrors are ignored.
+    memory_map_.map_read(0x0000, 0x1fff, memory_);
+    memory_map_.count_writes(0x0000, 0x1fff);
+    memory_map_.map(0x2000, 0x3fff, memory_ + 0x2000);
+    for (auto mirror = 0x4000; mirror < 0x10000; mirror += 0x2000)
+    {
+      memory_map_.map_read(mirror, mirror + 0x1fff, memory_ + 0x2000);
+    }
+
+    io_bus_.latch_in(1, &port1_);
+    io_bus_.latch_in(2, &port2_);
+    io_bus_.on_in(3, [this](std::uint8_t)
+    {
+      const std::uint16_t v = (shift1_ << 8) | shift0_;
+      return static_cast<std::uint8_t>((v >> (8 - shift_offset_)) & 0xff);
+    });
+    io_bus_.on_out(2, [this](std::uint8_t, std::uint8_t value){shift_offset_ = value & 0x07;});
+    io_bus_.on_out(4, [this](std::uint8_t, std::uint8_t value)
+    {
+      shift0_ = shift1_;
+      shift1_ = value;
+    });
+    io_bus_.ignore_out(3); // play sound
+    io_bus_.ignore_out(5); // play sound
+    io_bus_.ignore_out(6);
+
+    cpu_.use_compiled_blocks(space_invaders_compiled_blocks());
   }
 
+  // Inputs and the shift register on ports 1 to 4, sounds and the watchdog on ports 3, 5 and 6.
   [[nodiscard]]
-  std::uint8_t
-  in(std::uint8_t port)
-  const;
-
-  void
-  out(std::uint8_t port, std::uint8_t value);
+  cpp8080::specific::io_bus&
+  io_bus()
+  noexcept
+  {
+    return io_bus_;
+  }
 
   void
-  memory_write_byte(std::uint16_t address, std::uint8_t value);
+  memory_write_byte(std::uint16_t address, std::uint8_t value)
+  {
+    memory_map_.write_byte(address, value);
+  }
 
   [[nodiscard]]
   std::uint8_t
   memory_read_byte(std::uint16_t address)
-  const;
+  const
+  {
+    return memory_map_.read_byte(address);
+  }
+
+  void
+  memory_write_word(std::uint16_t address, std::uint16_t value)
+  {
+    memory_map_.write_word(address, value);
+  }
+
+  [[nodiscard]]
+  std::uint16_t
+  memory_read_word(std::uint16_t address)
+  const
+  {
+    return memory_map_.read_word(address);
+  }
+
+  // ROM and RAM, read directly by the cpu.
+  [[nodiscard]]
+  cpp8080::specific::memory_region
+  readable_memory()
+  const noexcept
+  {
+    return {memory_, 0, memory_size};
+  }
 
   void
   operator()();
@@ -95,9 +150,16 @@ private:
 
 private:
 
+  static constexpr auto memory_size = std::uint32_t{16384};
+
   std::unique_ptr<arcade> arcade_;
   cpp8080::specific::cpu<space_invaders> cpu_;
-  std::vector<std::uint8_t> memory_;
+  std::unique_ptr<cpp8080::specific::shared_memory> shared_memory_; // null if not exported
+  std::vector<std::uint8_t> local_memory_;                          // empty if exported
+  std::uint8_t* memory_;
+  cpp8080::specific::memory_map memory_map_;
+  cpp8080::specific::io_bus io_bus_;
+  cpp8080::specific::scheduler scheduler_;
   std::uint8_t shift0_;
   std::uint8_t shift1_;
   std::uint8_t shift_offset_;